@@ -1,38 +1,75 @@
+echo "g++ -Wfatal-errors -Wall -fdiagnostics-color=always -std=c++20 -o "obj/default/src/build_stats.o" -c "src/build_stats.cpp""
+mkdir -p "obj/default/src/"
+g++ -Wfatal-errors -Wall -fdiagnostics-color=always -std=c++20 -o "obj/default/src/build_stats.o" -c "src/build_stats.cpp"
+echo "g++ -Wfatal-errors -Wall -fdiagnostics-color=always -std=c++20 -o "obj/default/src/module_scanner.o" -c "src/module_scanner.cpp""
+mkdir -p "obj/default/src/"
+g++ -Wfatal-errors -Wall -fdiagnostics-color=always -std=c++20 -o "obj/default/src/module_scanner.o" -c "src/module_scanner.cpp"
+echo "g++ -Wfatal-errors -Wall -fdiagnostics-color=always -std=c++20 -o "obj/default/src/programs/git.o" -c "src/programs/git.cpp""
+mkdir -p "obj/default/src/programs/"
+g++ -Wfatal-errors -Wall -fdiagnostics-color=always -std=c++20 -o "obj/default/src/programs/git.o" -c "src/programs/git.cpp"
+echo "g++ -Wfatal-errors -Wall -fdiagnostics-color=always -std=c++20 -o "obj/default/src/programs/pkg_config.o" -c "src/programs/pkg_config.cpp""
+mkdir -p "obj/default/src/programs/"
+g++ -Wfatal-errors -Wall -fdiagnostics-color=always -std=c++20 -o "obj/default/src/programs/pkg_config.o" -c "src/programs/pkg_config.cpp"
+echo "g++ -Wfatal-errors -Wall -fdiagnostics-color=always -std=c++20 -o "obj/default/src/programs/linker.o" -c "src/programs/linker.cpp""
+mkdir -p "obj/default/src/programs/"
+g++ -Wfatal-errors -Wall -fdiagnostics-color=always -std=c++20 -o "obj/default/src/programs/linker.o" -c "src/programs/linker.cpp"
+echo "g++ -Wfatal-errors -Wall -fdiagnostics-color=always -std=c++20 -o "obj/default/src/commands.o" -c "src/commands.cpp""
+mkdir -p "obj/default/src/"
+g++ -Wfatal-errors -Wall -fdiagnostics-color=always -std=c++20 -o "obj/default/src/commands.o" -c "src/commands.cpp"
+echo "g++ -Wfatal-errors -Wall -fdiagnostics-color=always -std=c++20 -o "obj/default/src/asset_packer.o" -c "src/asset_packer.cpp""
+mkdir -p "obj/default/src/"
+g++ -Wfatal-errors -Wall -fdiagnostics-color=always -std=c++20 -o "obj/default/src/asset_packer.o" -c "src/asset_packer.cpp"
+echo "g++ -Wfatal-errors -Wall -fdiagnostics-color=always -std=c++20 -o "obj/default/src/config.o" -c "src/config.cpp""
+mkdir -p "obj/default/src/"
+g++ -Wfatal-errors -Wall -fdiagnostics-color=always -std=c++20 -o "obj/default/src/config.o" -c "src/config.cpp"
+echo "g++ -Wfatal-errors -Wall -fdiagnostics-color=always -std=c++20 -o "obj/default/src/project.o" -c "src/project.cpp""
+mkdir -p "obj/default/src/"
+g++ -Wfatal-errors -Wall -fdiagnostics-color=always -std=c++20 -o "obj/default/src/project.o" -c "src/project.cpp"
+echo "g++ -Wfatal-errors -Wall -fdiagnostics-color=always -std=c++20 -o "obj/default/src/unity_build.o" -c "src/unity_build.cpp""
+mkdir -p "obj/default/src/"
+g++ -Wfatal-errors -Wall -fdiagnostics-color=always -std=c++20 -o "obj/default/src/unity_build.o" -c "src/unity_build.cpp"
 echo "g++ -Wfatal-errors -Wall -fdiagnostics-color=always -std=c++20 -o "obj/default/src/file.o" -c "src/file.cpp""
 mkdir -p "obj/default/src/"
 g++ -Wfatal-errors -Wall -fdiagnostics-color=always -std=c++20 -o "obj/default/src/file.o" -c "src/file.cpp"
-echo "g++ -Wfatal-errors -Wall -fdiagnostics-color=always -std=c++20 -o "obj/default/src/utility/cmd.o" -c "src/utility/cmd.cpp""
-mkdir -p "obj/default/src/utility/"
-g++ -Wfatal-errors -Wall -fdiagnostics-color=always -std=c++20 -o "obj/default/src/utility/cmd.o" -c "src/utility/cmd.cpp"
-echo "g++ -Wfatal-errors -Wall -fdiagnostics-color=always -std=c++20 -o "obj/default/src/tokenizer/matcher.o" -c "src/tokenizer/matcher.cpp""
-mkdir -p "obj/default/src/tokenizer/"
-g++ -Wfatal-errors -Wall -fdiagnostics-color=always -std=c++20 -o "obj/default/src/tokenizer/matcher.o" -c "src/tokenizer/matcher.cpp"
+echo "g++ -Wfatal-errors -Wall -fdiagnostics-color=always -std=c++20 -o "obj/default/src/file_exporter.o" -c "src/file_exporter.cpp""
+mkdir -p "obj/default/src/"
+g++ -Wfatal-errors -Wall -fdiagnostics-color=always -std=c++20 -o "obj/default/src/file_exporter.o" -c "src/file_exporter.cpp"
+echo "g++ -Wfatal-errors -Wall -fdiagnostics-color=always -std=c++20 -o "obj/default/src/help.o" -c "src/help.cpp""
+mkdir -p "obj/default/src/"
+g++ -Wfatal-errors -Wall -fdiagnostics-color=always -std=c++20 -o "obj/default/src/help.o" -c "src/help.cpp"
 echo "g++ -Wfatal-errors -Wall -fdiagnostics-color=always -std=c++20 -o "obj/default/src/tokenizer/tokenizer.o" -c "src/tokenizer/tokenizer.cpp""
 mkdir -p "obj/default/src/tokenizer/"
 g++ -Wfatal-errors -Wall -fdiagnostics-color=always -std=c++20 -o "obj/default/src/tokenizer/tokenizer.o" -c "src/tokenizer/tokenizer.cpp"
 echo "g++ -Wfatal-errors -Wall -fdiagnostics-color=always -std=c++20 -o "obj/default/src/tokenizer/parse_context.o" -c "src/tokenizer/parse_context.cpp""
 mkdir -p "obj/default/src/tokenizer/"
 g++ -Wfatal-errors -Wall -fdiagnostics-color=always -std=c++20 -o "obj/default/src/tokenizer/parse_context.o" -c "src/tokenizer/parse_context.cpp"
+echo "g++ -Wfatal-errors -Wall -fdiagnostics-color=always -std=c++20 -o "obj/default/src/tokenizer/matcher.o" -c "src/tokenizer/matcher.cpp""
+mkdir -p "obj/default/src/tokenizer/"
+g++ -Wfatal-errors -Wall -fdiagnostics-color=always -std=c++20 -o "obj/default/src/tokenizer/matcher.o" -c "src/tokenizer/matcher.cpp"
 echo "g++ -Wfatal-errors -Wall -fdiagnostics-color=always -std=c++20 -o "obj/default/src/dependency_tree.o" -c "src/dependency_tree.cpp""
 mkdir -p "obj/default/src/"
 g++ -Wfatal-errors -Wall -fdiagnostics-color=always -std=c++20 -o "obj/default/src/dependency_tree.o" -c "src/dependency_tree.cpp"
-echo "g++ -Wfatal-errors -Wall -fdiagnostics-color=always -std=c++20 -o "obj/default/src/commands.o" -c "src/commands.cpp""
-mkdir -p "obj/default/src/"
-g++ -Wfatal-errors -Wall -fdiagnostics-color=always -std=c++20 -o "obj/default/src/commands.o" -c "src/commands.cpp"
-echo "g++ -Wfatal-errors -Wall -fdiagnostics-color=always -std=c++20 -o "obj/default/src/project.o" -c "src/project.cpp""
-mkdir -p "obj/default/src/"
-g++ -Wfatal-errors -Wall -fdiagnostics-color=always -std=c++20 -o "obj/default/src/project.o" -c "src/project.cpp"
-echo "g++ -Wfatal-errors -Wall -fdiagnostics-color=always -std=c++20 -o "obj/default/src/config.o" -c "src/config.cpp""
+echo "g++ -Wfatal-errors -Wall -fdiagnostics-color=always -std=c++20 -o "obj/default/src/utility/file_copy.o" -c "src/utility/file_copy.cpp""
+mkdir -p "obj/default/src/utility/"
+g++ -Wfatal-errors -Wall -fdiagnostics-color=always -std=c++20 -o "obj/default/src/utility/file_copy.o" -c "src/utility/file_copy.cpp"
+echo "g++ -Wfatal-errors -Wall -fdiagnostics-color=always -std=c++20 -o "obj/default/src/utility/cmd.o" -c "src/utility/cmd.cpp""
+mkdir -p "obj/default/src/utility/"
+g++ -Wfatal-errors -Wall -fdiagnostics-color=always -std=c++20 -o "obj/default/src/utility/cmd.o" -c "src/utility/cmd.cpp"
+echo "g++ -Wfatal-errors -Wall -fdiagnostics-color=always -std=c++20 -o "obj/default/src/utility/hash.o" -c "src/utility/hash.cpp""
+mkdir -p "obj/default/src/utility/"
+g++ -Wfatal-errors -Wall -fdiagnostics-color=always -std=c++20 -o "obj/default/src/utility/hash.o" -c "src/utility/hash.cpp"
+echo "g++ -Wfatal-errors -Wall -fdiagnostics-color=always -std=c++20 -o "obj/default/src/utility/host.o" -c "src/utility/host.cpp""
+mkdir -p "obj/default/src/utility/"
+g++ -Wfatal-errors -Wall -fdiagnostics-color=always -std=c++20 -o "obj/default/src/utility/host.o" -c "src/utility/host.cpp"
+echo "g++ -Wfatal-errors -Wall -fdiagnostics-color=always -std=c++20 -o "obj/default/src/scheduler.o" -c "src/scheduler.cpp""
 mkdir -p "obj/default/src/"
-g++ -Wfatal-errors -Wall -fdiagnostics-color=always -std=c++20 -o "obj/default/src/config.o" -c "src/config.cpp"
-echo "g++ -Wfatal-errors -Wall -fdiagnostics-color=always -std=c++20 -o "obj/default/src/programs/pkg_config.o" -c "src/programs/pkg_config.cpp""
-mkdir -p "obj/default/src/programs/"
-g++ -Wfatal-errors -Wall -fdiagnostics-color=always -std=c++20 -o "obj/default/src/programs/pkg_config.o" -c "src/programs/pkg_config.cpp"
-echo "g++ -Wfatal-errors -Wall -fdiagnostics-color=always -std=c++20 -o "obj/default/src/programs/git.o" -c "src/programs/git.cpp""
-mkdir -p "obj/default/src/programs/"
-g++ -Wfatal-errors -Wall -fdiagnostics-color=always -std=c++20 -o "obj/default/src/programs/git.o" -c "src/programs/git.cpp"
+g++ -Wfatal-errors -Wall -fdiagnostics-color=always -std=c++20 -o "obj/default/src/scheduler.o" -c "src/scheduler.cpp"
 echo "g++ -Wfatal-errors -Wall -fdiagnostics-color=always -std=c++20 -o "obj/default/src/main.o" -c "src/main.cpp""
 mkdir -p "obj/default/src/"
 g++ -Wfatal-errors -Wall -fdiagnostics-color=always -std=c++20 -o "obj/default/src/main.o" -c "src/main.cpp"
-echo "g++ -Wfatal-errors -Wall -Wextra -fdiagnostics-color=always -std=c++20 -o "bin/lzbuild" "obj/default/src/file.o" "obj/default/src/utility/cmd.o" "obj/default/src/tokenizer/matcher.o" "obj/default/src/tokenizer/tokenizer.o" "obj/default/src/tokenizer/parse_context.o" "obj/default/src/dependency_tree.o" "obj/default/src/commands.o" "obj/default/src/project.o" "obj/default/src/config.o" "obj/default/src/programs/pkg_config.o" "obj/default/src/programs/git.o" "obj/default/src/main.o" -pthread"
-g++ -Wfatal-errors -Wall -Wextra -fdiagnostics-color=always -std=c++20 -o "bin/lzbuild" "obj/default/src/file.o" "obj/default/src/utility/cmd.o" "obj/default/src/tokenizer/matcher.o" "obj/default/src/tokenizer/tokenizer.o" "obj/default/src/tokenizer/parse_context.o" "obj/default/src/dependency_tree.o" "obj/default/src/commands.o" "obj/default/src/project.o" "obj/default/src/config.o" "obj/default/src/programs/pkg_config.o" "obj/default/src/programs/git.o" "obj/default/src/main.o" -pthread
+echo "g++ -Wfatal-errors -Wall -fdiagnostics-color=always -std=c++20 -o "obj/default/src/restat_log.o" -c "src/restat_log.cpp""
+mkdir -p "obj/default/src/"
+g++ -Wfatal-errors -Wall -fdiagnostics-color=always -std=c++20 -o "obj/default/src/restat_log.o" -c "src/restat_log.cpp"
+echo "g++ -Wfatal-errors -Wall -Wextra -fdiagnostics-color=always -std=c++20 -o "bin/lzbuild" "obj/default/src/build_stats.o" "obj/default/src/module_scanner.o" "obj/default/src/programs/git.o" "obj/default/src/programs/pkg_config.o" "obj/default/src/programs/linker.o" "obj/default/src/commands.o" "obj/default/src/asset_packer.o" "obj/default/src/config.o" "obj/default/src/project.o" "obj/default/src/unity_build.o" "obj/default/src/file.o" "obj/default/src/file_exporter.o" "obj/default/src/help.o" "obj/default/src/tokenizer/tokenizer.o" "obj/default/src/tokenizer/parse_context.o" "obj/default/src/tokenizer/matcher.o" "obj/default/src/dependency_tree.o" "obj/default/src/utility/file_copy.o" "obj/default/src/utility/cmd.o" "obj/default/src/utility/hash.o" "obj/default/src/utility/host.o" "obj/default/src/scheduler.o" "obj/default/src/main.o" "obj/default/src/restat_log.o" -pthread"
+mkdir -p "bin"
+g++ -Wfatal-errors -Wall -Wextra -fdiagnostics-color=always -std=c++20 -o "bin/lzbuild" "obj/default/src/build_stats.o" "obj/default/src/module_scanner.o" "obj/default/src/programs/git.o" "obj/default/src/programs/pkg_config.o" "obj/default/src/programs/linker.o" "obj/default/src/commands.o" "obj/default/src/asset_packer.o" "obj/default/src/config.o" "obj/default/src/project.o" "obj/default/src/unity_build.o" "obj/default/src/file.o" "obj/default/src/file_exporter.o" "obj/default/src/help.o" "obj/default/src/tokenizer/tokenizer.o" "obj/default/src/tokenizer/parse_context.o" "obj/default/src/tokenizer/matcher.o" "obj/default/src/dependency_tree.o" "obj/default/src/utility/file_copy.o" "obj/default/src/utility/cmd.o" "obj/default/src/utility/hash.o" "obj/default/src/utility/host.o" "obj/default/src/scheduler.o" "obj/default/src/main.o" "obj/default/src/restat_log.o" -pthread
@@ -0,0 +1,278 @@
+#pragma once
+// Reader of the asset packs written by lzbuild (asset_format pack). Header only
+// and without dependencies so applications can copy it. The pack is mapped in
+// memory, uncompressed assets are used in place.
+//
+// Layout, little endian: a header, the asset data aligned to header.alignment,
+// then the index: one displacement per bucket of the perfect hash, the entries
+// in slot order and the asset names.
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+#include <vector>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace asset_pack
+{
+    constexpr char magic[8] = { 'L', 'Z', 'A', 'P', 'A', 'C', 'K', '1' };
+    constexpr uint32_t version = 1;
+    constexpr uint32_t compressed = 1; // entry flag
+
+    struct header
+    {
+        char magic[8];
+        uint32_t version;
+        uint32_t entry_count;
+        uint32_t alignment;
+        uint32_t reserved;
+        uint64_t index_offset;
+        uint64_t names_size;
+    };
+
+    struct entry
+    {
+        uint64_t offset;
+        uint64_t size;        // uncompressed
+        uint64_t stored_size; // in the pack
+        uint64_t hash;        // of the uncompressed content
+        uint32_t name_offset;
+        uint32_t name_size;
+        uint32_t flags;
+        uint32_t reserved;
+    };
+
+    // Slot of a name: bucket = hash(name, 0) % count, slot = hash(name, displacements[bucket]) % count
+    inline uint64_t hash_name(std::string_view name, uint32_t seed)
+    {
+        uint64_t hash = 0xCBF29CE484222325ull ^ (seed * 0x9E3779B97F4A7C15ull);
+        for (unsigned char c : name)
+        {
+            hash = (hash ^ c) * 0x100000001B3ull;
+        }
+        hash ^= hash >> 33;
+        hash *= 0xFF51AFD7ED558CCDull;
+        return hash ^ (hash >> 33);
+    }
+
+    // LZ77 sequences: a token (literal count << 4 | match length - 4, 15 meaning
+    // more bytes follow, each adding up to 255), the literals, then a 2 byte
+    // offset and the rest of the match length. The last sequence has no match.
+    inline bool decompress(const uint8_t* input, size_t input_size, uint8_t* output, size_t output_size)
+    {
+        size_t in = 0, out = 0;
+        auto read_length = [&](size_t& length) {
+            uint8_t byte = 255;
+            while (byte == 255)
+            {
+                if (in >= input_size)
+                {
+                    return false;
+                }
+                byte = input[in++];
+                length += byte;
+            }
+            return true;
+        };
+        while (in < input_size)
+        {
+            uint8_t token = input[in++];
+            size_t literals = token >> 4;
+            if (literals == 15 && !read_length(literals))
+            {
+                return false;
+            }
+            if (literals > input_size - in || literals > output_size - out)
+            {
+                return false;
+            }
+            std::memcpy(output + out, input + in, literals);
+            in += literals;
+            out += literals;
+            if (in == input_size)
+            {
+                break;
+            }
+            if (input_size - in < 2)
+            {
+                return false;
+            }
+            size_t offset = input[in] | (size_t(input[in + 1]) << 8);
+            in += 2;
+            size_t length = token & 15;
+            if (length == 15 && !read_length(length))
+            {
+                return false;
+            }
+            length += 4;
+            if (offset == 0 || offset > out || length > output_size - out)
+            {
+                return false;
+            }
+            // byte by byte, a match may overlap what it produces
+            for (size_t i = 0; i < length; i++, out++)
+            {
+                output[out] = output[out - offset];
+            }
+        }
+        return out == output_size;
+    }
+
+    class reader
+    {
+        const uint8_t* _data = nullptr;
+        size_t _size = 0;
+        const header* _header = nullptr;
+        const uint32_t* _displacements = nullptr;
+        const entry* _entries = nullptr;
+        const char* _names = nullptr;
+#ifdef _WIN32
+        HANDLE _file = INVALID_HANDLE_VALUE;
+        HANDLE _mapping = nullptr;
+#endif
+
+    public:
+        reader() = default;
+        explicit reader(const char* path) { open(path); }
+        reader(const reader&) = delete;
+        reader& operator=(const reader&) = delete;
+        ~reader() { close(); }
+
+        bool open(const char* path)
+        {
+            close();
+#ifdef _WIN32
+            _file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+            LARGE_INTEGER size;
+            if (_file == INVALID_HANDLE_VALUE || !GetFileSizeEx(_file, &size) || size.QuadPart == 0)
+            {
+                close();
+                return false;
+            }
+            _mapping = CreateFileMappingA(_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+            _data = _mapping ? static_cast<const uint8_t*>(MapViewOfFile(_mapping, FILE_MAP_READ, 0, 0, 0)) : nullptr;
+            _size = size_t(size.QuadPart);
+#else
+            int file = ::open(path, O_RDONLY | O_CLOEXEC);
+            struct stat status;
+            if (file < 0 || fstat(file, &status) != 0 || status.st_size == 0)
+            {
+                if (file >= 0)
+                {
+                    ::close(file);
+                }
+                return false;
+            }
+            void* data = mmap(nullptr, size_t(status.st_size), PROT_READ, MAP_SHARED, file, 0);
+            ::close(file);
+            _data = data == MAP_FAILED ? nullptr : static_cast<const uint8_t*>(data);
+            _size = size_t(status.st_size);
+#endif
+            if (!_data || !validate())
+            {
+                close();
+                return false;
+            }
+            return true;
+        }
+
+        void close()
+        {
+#ifdef _WIN32
+            if (_data) UnmapViewOfFile(_data);
+            if (_mapping) CloseHandle(_mapping);
+            if (_file != INVALID_HANDLE_VALUE) CloseHandle(_file);
+            _mapping = nullptr;
+            _file = INVALID_HANDLE_VALUE;
+#else
+            if (_data) munmap(const_cast<uint8_t*>(_data), _size);
+#endif
+            _data = nullptr;
+            _size = 0;
+            _header = nullptr;
+        }
+
+        bool is_open() const { return _header != nullptr; }
+        size_t size() const { return _header ? _header->entry_count : 0; }
+        const entry& at(size_t index) const { return _entries[index]; }
+        std::string_view get_name(const entry& e) const { return std::string_view(_names + e.name_offset, e.name_size); }
+
+        // Entry of an asset by its path relative to the asset folder, null when missing
+        const entry* find(std::string_view name) const
+        {
+            if (size() == 0)
+            {
+                return nullptr;
+            }
+            auto count = _header->entry_count;
+            auto bucket = hash_name(name, 0) % count;
+            auto& e = _entries[hash_name(name, _displacements[bucket]) % count];
+            return get_name(e) == name ? &e : nullptr;
+        }
+
+        // Bytes of an entry as stored, the content itself when it isn't compressed
+        std::string_view view(const entry& e) const
+        {
+            return std::string_view(reinterpret_cast<const char*>(_data + e.offset), e.stored_size);
+        }
+
+        // Content of an entry, decompressed when needed. Empty if the entry is corrupted.
+        std::vector<uint8_t> read(const entry& e) const
+        {
+            std::vector<uint8_t> content(e.size);
+            if (e.flags & compressed)
+            {
+                if (!decompress(_data + e.offset, e.stored_size, content.data(), content.size()))
+                {
+                    content.clear();
+                }
+            }
+            else
+            {
+                std::memcpy(content.data(), _data + e.offset, e.size);
+            }
+            return content;
+        }
+
+    private:
+        bool validate()
+        {
+            if (_size < sizeof(header))
+            {
+                return false;
+            }
+            auto h = reinterpret_cast<const header*>(_data);
+            uint64_t count = h->entry_count;
+            // displacements are padded so the entries stay 8 byte aligned
+            uint64_t entries_offset = h->index_offset + ((count * sizeof(uint32_t) + 7) & ~uint64_t(7));
+            uint64_t names_offset = entries_offset + count * sizeof(entry);
+            if (std::memcmp(h->magic, magic, sizeof(magic)) != 0 || h->version != version || h->index_offset % 8 != 0
+                || h->index_offset > _size || names_offset > _size || h->names_size > _size - names_offset)
+            {
+                return false;
+            }
+            _displacements = reinterpret_cast<const uint32_t*>(_data + h->index_offset);
+            _entries = reinterpret_cast<const entry*>(_data + entries_offset);
+            _names = reinterpret_cast<const char*>(_data + names_offset);
+            for (uint64_t i = 0; i < count; i++)
+            {
+                auto& e = _entries[i];
+                if (e.offset > h->index_offset || e.stored_size > h->index_offset - e.offset
+                    || uint64_t(e.name_offset) + e.name_size > h->names_size
+                    || (!(e.flags & compressed) && e.size != e.stored_size))
+                {
+                    return false;
+                }
+            }
+            _header = h;
+            return true;
+        }
+    };
+}
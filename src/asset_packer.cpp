@@ -0,0 +1,347 @@
+#include "asset_packer.hpp"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include "utility/hash.hpp"
+
+namespace fs = std::filesystem;
+
+namespace
+{
+    constexpr uint32_t alignment = 64;
+
+    void write_length(std::vector<uint8_t>& output, size_t length)
+    {
+        for (; length >= 255; length -= 255)
+        {
+            output.push_back(255);
+        }
+        output.push_back(uint8_t(length));
+    }
+
+    void write_sequence(std::vector<uint8_t>& output, const uint8_t* literals, size_t literal_count, size_t offset, size_t match)
+    {
+        size_t match_code = match >= 4 ? match - 4 : 0;
+        output.push_back(uint8_t((std::min<size_t>(literal_count, 15) << 4) | std::min<size_t>(match_code, 15)));
+        if (literal_count >= 15)
+        {
+            write_length(output, literal_count - 15);
+        }
+        output.insert(output.end(), literals, literals + literal_count);
+        if (match == 0)
+        {
+            return;
+        }
+        output.push_back(uint8_t(offset));
+        output.push_back(uint8_t(offset >> 8));
+        if (match_code >= 15)
+        {
+            write_length(output, match_code - 15);
+        }
+    }
+
+    // Greedy LZ77 in the format asset_pack::decompress reads
+    std::vector<uint8_t> compress(const std::vector<uint8_t>& input)
+    {
+        std::vector<uint8_t> output;
+        std::vector<uint32_t> table(1 << 16, UINT32_MAX);
+        size_t anchor = 0, position = 0, size = input.size();
+        while (position + 4 <= size)
+        {
+            uint32_t sequence;
+            std::memcpy(&sequence, input.data() + position, 4);
+            auto& slot = table[(sequence * 2654435761u) >> 16];
+            size_t candidate = slot;
+            slot = uint32_t(position);
+            if (candidate == UINT32_MAX || position - candidate > 65535 || std::memcmp(input.data() + candidate, input.data() + position, 4) != 0)
+            {
+                position++;
+                continue;
+            }
+            size_t match = 4;
+            while (position + match < size && input[candidate + match] == input[position + match])
+            {
+                match++;
+            }
+            write_sequence(output, input.data() + anchor, position - anchor, position - candidate, match);
+            position += match;
+            anchor = position;
+        }
+        write_sequence(output, input.data() + anchor, size - anchor, 0, 0);
+        return output;
+    }
+
+    void write_header(std::ostream& output, size_t count, uint64_t index_offset, uint64_t names_size)
+    {
+        asset_pack::header header{};
+        std::memcpy(header.magic, asset_pack::magic, sizeof(header.magic));
+        header.version = asset_pack::version;
+        header.entry_count = uint32_t(count);
+        header.alignment = alignment;
+        header.index_offset = index_offset;
+        header.names_size = names_size;
+        output.seekp(0);
+        output.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    }
+
+    void pad(std::ostream& output, uint64_t boundary)
+    {
+        static const char zeros[alignment] = {};
+        auto position = uint64_t(output.tellp());
+        output.write(zeros, (boundary - position % boundary) % boundary);
+    }
+}
+
+asset_packer::asset_packer(std::filesystem::path pack, bool compress) : _pack(pack), _compress(compress)
+{
+}
+
+std::map<std::string, std::pair<uintmax_t, long long>> asset_packer::load_manifest()
+{
+    std::map<std::string, std::pair<uintmax_t, long long>> manifest;
+    auto path = _pack;
+    std::ifstream file(path += ".manifest");
+    std::string line;
+    while (std::getline(file, line))
+    {
+        // <size> <write time> <name>
+        std::stringstream ss(line);
+        uintmax_t size = 0;
+        long long time = 0;
+        std::string name;
+        ss >> size >> time;
+        std::getline(ss >> std::ws, name);
+        if (!ss.fail() && !name.empty())
+        {
+            manifest[name] = { size, time };
+        }
+    }
+    return manifest;
+}
+
+void asset_packer::save_manifest(const std::vector<asset>& assets)
+{
+    auto path = _pack;
+    std::ofstream file(path += ".manifest");
+    for (auto& asset : assets)
+    {
+        file << asset.entry.size << " " << fs::last_write_time(asset.path).time_since_epoch().count() << " " << asset.name << "\n";
+    }
+}
+
+std::vector<uint32_t> asset_packer::build_table(std::vector<asset>& assets)
+{
+    // hash and displace: the largest buckets pick a seed first, while most slots are free
+    size_t count = assets.size();
+    std::vector<std::vector<size_t>> buckets(count);
+    for (size_t i = 0; i < count; i++)
+    {
+        buckets[asset_pack::hash_name(assets[i].name, 0) % count].push_back(i);
+    }
+    std::vector<size_t> order(count);
+    for (size_t i = 0; i < count; i++)
+    {
+        order[i] = i;
+    }
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return buckets[a].size() > buckets[b].size(); });
+
+    std::vector<uint32_t> displacements(count, 0);
+    std::vector<bool> taken(count, false);
+    std::vector<size_t> slot_of(count);
+    for (auto bucket : order)
+    {
+        if (buckets[bucket].empty())
+        {
+            break;
+        }
+        for (uint32_t seed = 1;; seed++)
+        {
+            if (seed == UINT32_MAX)
+            {
+                throw std::string("Could not build the asset lookup table");
+            }
+            std::vector<size_t> slots;
+            for (auto i : buckets[bucket])
+            {
+                auto slot = asset_pack::hash_name(assets[i].name, seed) % count;
+                if (taken[slot] || std::find(slots.begin(), slots.end(), slot) != slots.end())
+                {
+                    break;
+                }
+                slots.push_back(slot);
+            }
+            if (slots.size() == buckets[bucket].size())
+            {
+                displacements[bucket] = seed;
+                for (size_t k = 0; k < slots.size(); k++)
+                {
+                    taken[slots[k]] = true;
+                    slot_of[buckets[bucket][k]] = slots[k];
+                }
+                break;
+            }
+        }
+    }
+
+    std::vector<asset> ordered(count);
+    for (size_t i = 0; i < count; i++)
+    {
+        ordered[slot_of[i]] = std::move(assets[i]);
+    }
+    assets = std::move(ordered);
+    return displacements;
+}
+
+void asset_packer::write_index(std::ostream& output, std::vector<asset>& assets, uint64_t& index_offset, uint64_t& names_size)
+{
+    pad(output, 8);
+    index_offset = uint64_t(output.tellp());
+    auto displacements = build_table(assets);
+    output.write(reinterpret_cast<const char*>(displacements.data()), displacements.size() * sizeof(uint32_t));
+    pad(output, 8);
+    names_size = 0;
+    for (auto& asset : assets)
+    {
+        asset.entry.name_offset = uint32_t(names_size);
+        asset.entry.name_size = uint32_t(asset.name.size());
+        names_size += asset.name.size();
+        output.write(reinterpret_cast<const char*>(&asset.entry), sizeof(asset.entry));
+    }
+    for (auto& asset : assets)
+    {
+        output.write(asset.name.data(), asset.name.size());
+    }
+}
+
+size_t asset_packer::update(const std::filesystem::path& folder)
+{
+    auto manifest = load_manifest();
+    asset_pack::reader previous(_pack.string().c_str());
+
+    std::vector<asset> assets;
+    size_t written = 0;
+    uint64_t live = 0, appended = 0;
+    for (auto& item : fs::recursive_directory_iterator(folder))
+    {
+        if (!item.is_regular_file())
+        {
+            continue;
+        }
+        asset a;
+        a.name = fs::relative(item.path(), folder).generic_string();
+        a.path = item.path();
+        auto size = item.file_size();
+        auto old = previous.find(a.name);
+        auto recorded = manifest.find(a.name);
+        // compressed entries are rewritten when compression is turned off
+        bool reusable = old != nullptr && old->size == size && (_compress || !(old->flags & asset_pack::compressed));
+        if (reusable && recorded != manifest.end() && recorded->second.first == size
+            && recorded->second.second == fs::last_write_time(item.path()).time_since_epoch().count())
+        {
+            a.entry = *old;
+        }
+        else
+        {
+            std::ifstream file(item.path(), std::ios::binary);
+            std::vector<uint8_t> content(size);
+            file.read(reinterpret_cast<char*>(content.data()), size);
+            auto content_hash = hash::bytes(content.data(), content.size());
+            if (reusable && old->hash == content_hash)
+            {
+                a.entry = *old;
+            }
+            else
+            {
+                a.entry.size = size;
+                a.entry.hash = content_hash;
+                if (_compress)
+                {
+                    // kept when it saves at least an eighth
+                    auto packed = compress(content);
+                    if (packed.size() + packed.size() / 8 < content.size())
+                    {
+                        a.data = std::move(packed);
+                        a.entry.flags |= asset_pack::compressed;
+                    }
+                }
+                if (!(a.entry.flags & asset_pack::compressed))
+                {
+                    a.data = std::move(content);
+                }
+                a.entry.stored_size = a.data.size();
+                appended += a.data.size() + alignment;
+                written++;
+            }
+        }
+        live += a.entry.stored_size;
+        assets.push_back(std::move(a));
+    }
+    if (written == 0 && previous.is_open() && previous.size() == assets.size())
+    {
+        save_manifest(assets);
+        return 0;
+    }
+
+    uint64_t index_offset = 0, names_size = 0;
+    auto file_size = previous.is_open() ? fs::file_size(_pack) : 0;
+    if (!previous.is_open() || file_size + appended > 2 * live)
+    {
+        // rewritten without the dead data
+        auto temporary = _pack;
+        temporary += ".tmp";
+        std::ofstream output(temporary, std::ios::binary);
+        output.write(std::string(alignment, '\0').data(), alignment);
+        for (auto& asset : assets)
+        {
+            pad(output, alignment);
+            auto offset = uint64_t(output.tellp());
+            if (asset.data.empty())
+            {
+                auto stored = previous.view(asset.entry);
+                output.write(stored.data(), stored.size());
+            }
+            else
+            {
+                output.write(reinterpret_cast<const char*>(asset.data.data()), asset.data.size());
+            }
+            asset.entry.offset = offset;
+        }
+        write_index(output, assets, index_offset, names_size);
+        write_header(output, assets.size(), index_offset, names_size);
+        output.close();
+        if (!output)
+        {
+            throw std::string("Could not write ") + temporary.string();
+        }
+        previous.close();
+        fs::rename(temporary, _pack);
+    }
+    else
+    {
+        // appended after the previous index, which stays valid until the header changes
+        previous.close();
+        std::fstream output(_pack, std::ios::binary | std::ios::in | std::ios::out);
+        output.seekp(0, std::ios::end);
+        for (auto& asset : assets)
+        {
+            if (asset.data.empty())
+            {
+                continue;
+            }
+            pad(output, alignment);
+            asset.entry.offset = uint64_t(output.tellp());
+            output.write(reinterpret_cast<const char*>(asset.data.data()), asset.data.size());
+        }
+        write_index(output, assets, index_offset, names_size);
+        output.flush();
+        write_header(output, assets.size(), index_offset, names_size);
+        output.close();
+        if (!output)
+        {
+            throw std::string("Could not write ") + _pack.string();
+        }
+    }
+    save_manifest(assets);
+    return written;
+}
@@ -0,0 +1,40 @@
+#pragma once
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <string>
+#include <vector>
+#include "asset_pack.hpp"
+
+// Packs an asset folder into one file read by asset_pack::reader. The pack is
+// updated in place: assets whose size and write time didn't change keep their
+// data, changed ones are appended with a new index after them and the header
+// is rewritten last, so an interrupted update leaves the previous pack
+// readable. The pack is rewritten once its dead data outweighs the live data.
+class asset_packer
+{
+    struct asset
+    {
+        std::string name;
+        std::filesystem::path path;
+        asset_pack::entry entry{};
+        std::vector<uint8_t> data; // new stored bytes, empty when the entry is kept
+    };
+
+    std::filesystem::path _pack;
+    bool _compress;
+
+public:
+    asset_packer(std::filesystem::path pack, bool compress);
+
+    // Packs the files of folder, returns the number of assets written
+    size_t update(const std::filesystem::path& folder);
+
+private:
+    // size and write time of each packed asset, by name
+    std::map<std::string, std::pair<uintmax_t, long long>> load_manifest();
+    void save_manifest(const std::vector<asset>& assets);
+    // Orders the assets by slot and returns the displacement of each bucket
+    std::vector<uint32_t> build_table(std::vector<asset>& assets);
+    void write_index(std::ostream& output, std::vector<asset>& assets, uint64_t& index_offset, uint64_t& names_size);
+};
@@ -0,0 +1,374 @@
+#include "build_stats.hpp"
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <map>
+#include <sstream>
+#include <unordered_map>
+#include "utility/term.hpp"
+
+namespace fs = std::filesystem;
+
+const char* kind_name(job_kind kind)
+{
+    switch (kind)
+    {
+    case job_kind::compile: return "compile";
+    case job_kind::link: return "link";
+    case job_kind::pch: return "pch";
+    case job_kind::partial_link: return "partial_link";
+    }
+    return "compile";
+}
+
+std::optional<job_kind> parse_kind(const std::string& name)
+{
+    if (name == "compile") return job_kind::compile;
+    if (name == "link") return job_kind::link;
+    if (name == "pch") return job_kind::pch;
+    if (name == "partial_link") return job_kind::partial_link;
+    return std::nullopt;
+}
+
+build_stats::build_stats(std::filesystem::path path) : _path(path)
+{
+}
+
+void build_stats::load()
+{
+    _builds.clear();
+    _latest.clear();
+    std::ifstream file(_path);
+    std::string line;
+    while (std::getline(file, line))
+    {
+        std::stringstream ss(line);
+        std::string kind;
+        ss >> kind;
+        if (kind == "build")
+        {
+            build_record build;
+            ss >> build.timestamp >> build.wall_time >> build.pch >> build.linker;
+            if (build.linker == "-")
+            {
+                build.linker.clear();
+            }
+            _builds.push_back(build);
+            continue;
+        }
+        auto parsed_kind = parse_kind(kind);
+        if (!parsed_kind.has_value() || _builds.empty())
+        {
+            continue;
+        }
+        job_record job;
+        job.kind = parsed_kind.value();
+        ss >> job.start >> job.wall_time >> job.cpu_time >> job.peak_rss;
+        std::getline(ss >> std::ws, job.target);
+        if (!ss.fail() && !job.target.empty())
+        {
+            _builds.back().jobs.push_back(job);
+            index(job);
+        }
+    }
+}
+
+void build_stats::save()
+{
+    while (_builds.size() > _history_size)
+    {
+        _builds.pop_front();
+    }
+    fs::create_directories(_path.parent_path());
+    std::ofstream file(_path);
+    for (auto& build : _builds)
+    {
+        file << "build " << build.timestamp << " " << build.wall_time << " " << build.pch << " "
+             << (build.linker.empty() ? "-" : build.linker) << "\n";
+        for (auto& job : build.jobs)
+        {
+            file << kind_name(job.kind) << " " << job.start << " " << job.wall_time << " "
+                 << job.cpu_time << " " << job.peak_rss << " " << job.target << "\n";
+        }
+    }
+}
+
+void build_stats::begin_build()
+{
+    std::lock_guard lock(_mutex);
+    build_record build;
+    build.timestamp = std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+    _builds.push_back(build);
+}
+
+void build_stats::record(job_kind kind, const std::string& target, double start, const Process::Stats& stats)
+{
+    std::lock_guard lock(_mutex);
+    if (_builds.empty())
+    {
+        return;
+    }
+    _builds.back().jobs.push_back(job_record{
+        .kind = kind,
+        .target = target,
+        .start = start,
+        .wall_time = stats.wall_time,
+        .cpu_time = stats.cpu_time,
+        .peak_rss = stats.peak_rss
+    });
+    index(_builds.back().jobs.back());
+}
+
+void build_stats::set_pch(bool pch)
+{
+    std::lock_guard lock(_mutex);
+    if (!_builds.empty())
+    {
+        _builds.back().pch = pch;
+    }
+}
+
+void build_stats::set_linker(const std::string& linker)
+{
+    std::lock_guard lock(_mutex);
+    if (!_builds.empty())
+    {
+        _builds.back().linker = linker;
+    }
+}
+
+void build_stats::end_build(double wall_time)
+{
+    std::lock_guard lock(_mutex);
+    if (_builds.empty())
+    {
+        return;
+    }
+    if (_builds.back().jobs.empty())
+    {
+        // nothing was run, keep the history meaningful
+        _builds.pop_back();
+        return;
+    }
+    _builds.back().wall_time = wall_time;
+}
+
+std::optional<job_record> build_stats::find_last(job_kind kind, const std::string& target) const
+{
+    if (auto it = _latest.find(std::string(kind_name(kind)) + " " + target); it != _latest.end())
+    {
+        return it->second;
+    }
+    return std::nullopt;
+}
+
+void build_stats::index(const job_record& job)
+{
+    _latest[std::string(kind_name(job.kind)) + " " + job.target] = job;
+}
+
+void build_stats::report(std::ostream& output, size_t regression_window, size_t count) const
+{
+    if (_builds.empty())
+    {
+        output << "No build statistics recorded yet." << std::endl;
+        return;
+    }
+
+    // latest known record of every compile job, across the whole history
+    std::unordered_map<std::string, job_record> latest;
+    for (auto& build : _builds)
+    {
+        for (auto& job : build.jobs)
+        {
+            if (job.kind == job_kind::compile)
+            {
+                latest[job.target] = job;
+            }
+        }
+    }
+
+    output << std::fixed << std::setprecision(2);
+    const auto& last_build = _builds.back();
+    output << _builds.size() << " builds recorded, last build took " << last_build.wall_time << "s" << std::endl;
+
+    std::vector<job_record> slowest;
+    for (auto& [target, job] : latest)
+    {
+        slowest.push_back(job);
+    }
+    std::sort(slowest.begin(), slowest.end(), [](auto& a, auto& b) { return a.wall_time > b.wall_time; });
+    output << std::endl << term::cyan << "Slowest translation units:" << term::reset << std::endl;
+    for (size_t i = 0; i < slowest.size() && i < count; i++)
+    {
+        auto& job = slowest[i];
+        output << "  " << std::setw(8) << job.wall_time << "s  " << std::setw(8) << job.cpu_time << "s cpu  "
+               << std::setw(8) << job.peak_rss / 1024 << " MB  " << job.target << std::endl;
+    }
+
+    struct regression
+    {
+        std::string target;
+        double previous;
+        double current;
+    };
+    std::vector<regression> regressions;
+    for (auto& job : last_build.jobs)
+    {
+        double total = 0.0;
+        size_t samples = 0;
+        size_t first = _builds.size() - 1 >= regression_window ? _builds.size() - 1 - regression_window : 0;
+        for (size_t i = first; i + 1 < _builds.size(); i++)
+        {
+            for (auto& previous : _builds[i].jobs)
+            {
+                if (previous.kind == job.kind && previous.target == job.target)
+                {
+                    total += previous.wall_time;
+                    samples++;
+                }
+            }
+        }
+        if (samples == 0)
+        {
+            continue;
+        }
+        double mean = total / samples;
+        if (job.wall_time > mean * 1.25 && job.wall_time - mean > 0.1)
+        {
+            regressions.push_back({job.target, mean, job.wall_time});
+        }
+    }
+    std::sort(regressions.begin(), regressions.end(), [](auto& a, auto& b) { return a.current - a.previous > b.current - b.previous; });
+    output << std::endl << term::cyan << "Regressions against the previous " << regression_window << " builds:" << term::reset << std::endl;
+    if (regressions.empty())
+    {
+        output << "  none" << std::endl;
+    }
+    for (size_t i = 0; i < regressions.size() && i < count; i++)
+    {
+        auto& r = regressions[i];
+        output << "  " << term::yellow << "+" << std::setw(7) << r.current - r.previous << "s" << term::reset
+               << "  (" << r.previous << "s -> " << r.current << "s)  " << r.target << std::endl;
+    }
+
+    std::map<std::string, double> directories;
+    for (auto& [target, job] : latest)
+    {
+        directories[fs::path(target).parent_path().string()] += job.cpu_time;
+    }
+    std::vector<std::pair<std::string, double>> sorted_directories(directories.begin(), directories.end());
+    std::sort(sorted_directories.begin(), sorted_directories.end(), [](auto& a, auto& b) { return a.second > b.second; });
+    output << std::endl << term::cyan << "CPU time per directory:" << term::reset << std::endl;
+    for (auto& [directory, cpu_time] : sorted_directories)
+    {
+        output << "  " << std::setw(8) << cpu_time << "s  " << (directory.empty() ? "." : directory) << std::endl;
+    }
+
+    // compare every translation unit's latest compile with and without the
+    // precompiled header
+    std::unordered_map<std::string, double> with_pch;
+    std::unordered_map<std::string, double> without_pch;
+    for (auto& build : _builds)
+    {
+        for (auto& job : build.jobs)
+        {
+            if (job.kind == job_kind::compile)
+            {
+                (build.pch ? with_pch : without_pch)[job.target] = job.wall_time;
+            }
+        }
+    }
+    if (!with_pch.empty())
+    {
+        double saved = 0.0;
+        size_t compared = 0;
+        for (auto& [target, time] : with_pch)
+        {
+            if (auto it = without_pch.find(target); it != without_pch.end())
+            {
+                saved += it->second - time;
+                compared++;
+            }
+        }
+        output << std::endl << term::cyan << "Precompiled header:" << term::reset << std::endl;
+        for (auto build = _builds.rbegin(); build != _builds.rend(); ++build)
+        {
+            auto pch = std::find_if(build->jobs.begin(), build->jobs.end(), [](auto& job) { return job.kind == job_kind::pch; });
+            if (pch != build->jobs.end())
+            {
+                output << "  " << pch->target << " built in " << pch->wall_time << "s" << std::endl;
+                break;
+            }
+        }
+        if (compared > 0)
+        {
+            output << "  measured saving " << saved << "s over " << compared << " translation units ("
+                   << saved / compared << "s each)" << std::endl;
+        }
+        else
+        {
+            output << "  no compile without it to compare against yet" << std::endl;
+        }
+    }
+
+    // average link time of each linker used
+    std::map<std::string, std::pair<double, size_t>> linkers;
+    for (auto& build : _builds)
+    {
+        for (auto& job : build.jobs)
+        {
+            if (job.kind == job_kind::link)
+            {
+                auto& [time, count] = linkers[build.linker.empty() ? "default" : build.linker];
+                time += job.wall_time;
+                count++;
+            }
+        }
+    }
+    if (!linkers.empty())
+    {
+        output << std::endl << term::cyan << "Link time per linker:" << term::reset << std::endl;
+        for (auto& [linker, link] : linkers)
+        {
+            output << "  " << std::setw(8) << link.first / link.second << "s  " << linker << " (" << link.second << " links)" << std::endl;
+        }
+    }
+
+    // walk back from the last job to finish, each step taking the job that
+    // finished last before the current one started
+    std::vector<const job_record*> critical_path;
+    const job_record* current = nullptr;
+    for (auto& job : last_build.jobs)
+    {
+        if (current == nullptr || job.start + job.wall_time > current->start + current->wall_time)
+        {
+            current = &job;
+        }
+    }
+    while (current != nullptr)
+    {
+        critical_path.push_back(current);
+        const job_record* previous = nullptr;
+        for (auto& job : last_build.jobs)
+        {
+            double end = job.start + job.wall_time;
+            if (job.start < current->start && end <= current->start && (previous == nullptr || end > previous->start + previous->wall_time))
+            {
+                previous = &job;
+            }
+        }
+        current = previous;
+    }
+    double critical_time = 0.0;
+    for (auto job : critical_path)
+    {
+        critical_time += job->wall_time;
+    }
+    output << std::endl << term::cyan << "Critical path of the last build (" << critical_time << "s):" << term::reset << std::endl;
+    for (auto job = critical_path.rbegin(); job != critical_path.rend(); ++job)
+    {
+        output << "  " << std::setw(8) << (*job)->wall_time << "s  " << kind_name((*job)->kind) << " " << (*job)->target << std::endl;
+    }
+}
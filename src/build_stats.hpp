@@ -0,0 +1,68 @@
+#pragma once
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <mutex>
+#include <optional>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "utility/cmd.hpp"
+
+enum class job_kind
+{
+    compile,
+    link,
+    pch,
+    partial_link
+};
+
+struct job_record
+{
+    job_kind kind;
+    std::string target;
+    double start = 0.0;     // seconds since the start of the build
+    double wall_time = 0.0;
+    double cpu_time = 0.0;
+    long peak_rss = 0;      // kilobytes
+};
+
+struct build_record
+{
+    int64_t timestamp = 0;  // seconds since epoch
+    double wall_time = 0.0;
+    bool pch = false;       // sources were compiled with a precompiled header
+    std::string linker;     // empty for the default linker
+    std::vector<job_record> jobs;
+};
+
+// Persistent history of compiler and linker invocations, one store per config
+class build_stats
+{
+    std::filesystem::path _path;
+    std::deque<build_record> _builds;
+    std::unordered_map<std::string, job_record> _latest;
+    std::mutex _mutex;
+    size_t _history_size = 20;
+
+public:
+    build_stats(std::filesystem::path path);
+
+    void load();
+    void save();
+
+    void begin_build();
+    void record(job_kind kind, const std::string& target, double start, const Process::Stats& stats);
+    void set_pch(bool pch);
+    void set_linker(const std::string& linker);
+    void end_build(double wall_time);
+
+    std::optional<job_record> find_last(job_kind kind, const std::string& target) const;
+    const std::deque<build_record>& get_builds() const { return _builds; }
+
+    void report(std::ostream& output, size_t regression_window, size_t count) const;
+
+private:
+    void index(const job_record& job);
+};
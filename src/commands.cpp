@@ -79,8 +79,7 @@ bool export_project()
     {
         build_options sub_options;
         project maker(sub_options);
-        maker.build_file_registry();
-        
+
         if(maker.is_library())
         {
             maker.export_header_files(INCLUDE_EXPORT_PATH);
@@ -106,4 +105,42 @@ bool export_project()
     }
     std::cout << "failed for some reason" << std::endl;
     return false;
+}
+
+bool pgo(build_options options, std::optional<std::string> training)
+{
+    options.profile = "pgo-generate";
+    {
+        project instrumented(options);
+        auto data = instrumented.get_profile_data();
+        // counters of an older binary would not match the new objects
+        fs::remove_all(data);
+        if (instrumented.build() == Process::Result::Failed)
+        {
+            return false;
+        }
+        if (!training.has_value())
+        {
+            training = instrumented.get_training_command();
+        }
+        if (!training.has_value())
+        {
+            throw std::string("No training command, set pgo_train in the config or use --train <command>");
+        }
+        fs::create_directories(data);
+        std::cout << term::cyan << "Training: " << training.value() << term::reset << std::endl;
+        if (Process::Run(training.value(), std::cout) == Process::Result::Failed)
+        {
+            std::cerr << term::red << "Training command failed" << term::reset << std::endl;
+            return false;
+        }
+        if (instrumented.merge_profiles() == Process::Result::Failed)
+        {
+            std::cerr << term::red << "Failed to merge the profiles" << term::reset << std::endl;
+            return false;
+        }
+    }
+    options.profile = "pgo-use";
+    project optimized(options);
+    return optimized.build() != Process::Result::Failed;
 }
\ No newline at end of file
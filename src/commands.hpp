@@ -1,7 +1,12 @@
 #pragma once
 #include "utility/args.hpp"
 #include <filesystem>
+#include <optional>
+#include <string>
+#include "project.hpp"
 
 void init(std::filesystem::path path);
 bool install(std::filesystem::path repository, std::filesystem::path self_cmd);
-bool export_project();
\ No newline at end of file
+bool export_project();
+// Builds instrumented, runs the training command and rebuilds with the profile
+bool pgo(build_options options, std::optional<std::string> training);
\ No newline at end of file
@@ -3,6 +3,8 @@
 #include "utility/term.hpp"
 #include "tokenizer/tokenizer.hpp"
 #include "tokenizer/extensions.hpp"
+#include "scheduler.hpp"
+#include "utility/host.hpp"
 #include <algorithm>
 #include <fstream>
 #include <sstream>
@@ -39,6 +41,26 @@ enum class keywords
     cflags,
     macro,
     asset_folder,
+    asset_format,
+    jobs,
+    max_load,
+    pool,
+    dependency,
+    pch,
+    pch_threshold,
+    unity,
+    unity_batch_size,
+    unity_split_edits,
+    compile_batch,
+    compile_batch_time,
+    archive,
+    visibility,
+    version_script,
+    linker,
+    partial_link,
+    debug_info,
+    pgo_train,
+    export_method,
 };
 
 std::unordered_map<std::string, keywords> keywords_values = {
@@ -53,6 +75,26 @@ std::unordered_map<std::string, keywords> keywords_values = {
     {"cflags", keywords::cflags},
     {"macro", keywords::macro},
     {"asset_folder", keywords::asset_folder},
+    {"asset_format", keywords::asset_format},
+    {"jobs", keywords::jobs},
+    {"max_load", keywords::max_load},
+    {"pool", keywords::pool},
+    {"dependency", keywords::dependency},
+    {"pch", keywords::pch},
+    {"pch_threshold", keywords::pch_threshold},
+    {"unity", keywords::unity},
+    {"unity_batch_size", keywords::unity_batch_size},
+    {"unity_split_edits", keywords::unity_split_edits},
+    {"compile_batch", keywords::compile_batch},
+    {"compile_batch_time", keywords::compile_batch_time},
+    {"archive", keywords::archive},
+    {"visibility", keywords::visibility},
+    {"version_script", keywords::version_script},
+    {"linker", keywords::linker},
+    {"partial_link", keywords::partial_link},
+    {"debug_info", keywords::debug_info},
+    {"pgo_train", keywords::pgo_train},
+    {"export_method", keywords::export_method},
 };
 std::vector<std::string> keywords_keys = ([]() {
     std::vector<string> keys(keywords_values.size());
@@ -66,6 +108,7 @@ tokenizer::engine<token_type> create_tokenizer_engine()
     engine.add<token_type::keyword, tokenizer::keyword_matcher>(keywords_keys);
     engine.add<token_type::syntax>("[\n]");
     engine.add<token_type::name>("[@_][@_#+-]*");
+    engine.add<token_type::number>("#[#.]*");
     engine.add<token_type::comment, tokenizer::line_comment_matcher, true>("#");
     engine.add<token_type::string_literal, tokenizer::string_literal_matcher>();
     return engine;
@@ -87,6 +130,16 @@ std::string read_name(tokenizer::parse_context<token_type>& ctx)
     throw std::runtime_error("unexpected token" + token.str());
 }
 
+double read_number(tokenizer::parse_context<token_type>& ctx)
+{
+    auto token = ctx.advance();
+    if(token.match<token_type::number>())
+    {
+        return std::stod(token.value);
+    }
+    throw std::runtime_error("expected number, got " + token.str());
+}
+
 std::vector<std::string> read_name_list(tokenizer::parse_context<token_type>& ctx)
 {
     std::vector<std::string> values;
@@ -97,6 +150,29 @@ std::vector<std::string> read_name_list(tokenizer::parse_context<token_type>& ct
     return values;
 }
 
+// pkg-config lookups are independent, run them in the tool pool
+void resolve_libraries(config& config)
+{
+    scheduler jobs(std::cout, host::get_cpu_count());
+    if(auto it = config.pools.find(job_pool::tool); it != config.pools.end())
+    {
+        jobs.set_pool_limit(job_pool::tool, it->second);
+    }
+    for(auto& lib: config.libraries)
+    {
+        scheduler::job job;
+        job.name = lib.name;
+        job.pool = job_pool::tool;
+        job.action = [&lib](std::stringstream&, Process::Stats&)
+            {
+                lib.config = pkg_config::get_config(lib.name);
+                return Process::Result::Success;
+            };
+        jobs.add(std::move(job));
+    }
+    jobs.run();
+}
+
 void read_config(config& config, std::filesystem::path path)
 {
     std::ifstream file(path);
@@ -113,7 +189,7 @@ void read_config(config& config, std::filesystem::path path)
             auto libs = read_name_list(ctx);
             for(auto& lib: libs) config.libraries.push_back({
                 .name = lib,
-                .config = pkg_config::get_config(lib)
+                .config = {}
             });
         }},
         {keywords::name, [&]() {
@@ -131,12 +207,17 @@ void read_config(config& config, std::filesystem::path path)
             auto token = ctx.advance();
             if(token.match<token_type::name>("library")) {
                 config.is_library = true;
+                config.link_type = library_link_type::_static;
+            }
+            else if (token.match<token_type::name>("shared")) {
+                config.is_library = true;
+                config.link_type = library_link_type::shared;
             }
             else if (token.match<token_type::name>("binary")) {
                 config.is_library = false;
             }
             else {
-                throw std::runtime_error("Invalid output value(library|binary): " + token.str());
+                throw std::runtime_error("Invalid output value(library|shared|binary): " + token.str());
             }
         }},
         {keywords::source, [&]() {
@@ -160,6 +241,156 @@ void read_config(config& config, std::filesystem::path path)
         {keywords::asset_folder, [&]() {
             config.asset_folder = read_name(ctx);
         }},
+        {keywords::asset_format, [&]() {
+            auto token = ctx.advance();
+            if(token.match<token_type::name>("files")) {
+                config.pack_assets = false;
+            }
+            else if (token.match<token_type::name>("pack")) {
+                config.pack_assets = true;
+                config.compress_assets = false;
+            }
+            else if (token.match<token_type::name>("compressed")) {
+                config.pack_assets = true;
+                config.compress_assets = true;
+            }
+            else {
+                throw std::runtime_error("Invalid asset_format value(files|pack|compressed): " + token.str());
+            }
+        }},
+        {keywords::jobs, [&]() {
+            config.jobs = (size_t)read_number(ctx);
+        }},
+        {keywords::max_load, [&]() {
+            config.max_load = read_number(ctx);
+        }},
+        {keywords::dependency, [&]() {
+            auto dependencies = read_name_list(ctx);
+            config.dependencies.insert(config.dependencies.end(), dependencies.begin(), dependencies.end());
+        }},
+        {keywords::pch, [&]() {
+            auto token = ctx.advance();
+            if(token.match<token_type::name>("auto")) {
+                config.pch = true;
+            }
+            else if (token.match<token_type::name>("off")) {
+                config.pch = false;
+            }
+            else {
+                throw std::runtime_error("Invalid pch value(auto|off): " + token.str());
+            }
+        }},
+        {keywords::pch_threshold, [&]() {
+            config.pch_threshold = read_number(ctx);
+        }},
+        {keywords::unity, [&]() {
+            auto token = ctx.advance();
+            if(token.match<token_type::name>("directory")) {
+                config.unity = unity_mode::directory;
+            }
+            else if (token.match<token_type::name>("size")) {
+                config.unity = unity_mode::size;
+            }
+            else if (token.match<token_type::name>("off")) {
+                config.unity = unity_mode::off;
+            }
+            else {
+                throw std::runtime_error("Invalid unity value(directory|size|off): " + token.str());
+            }
+        }},
+        {keywords::unity_batch_size, [&]() {
+            config.unity_batch_size = (size_t)read_number(ctx);
+        }},
+        {keywords::unity_split_edits, [&]() {
+            config.unity_split_edits = (size_t)read_number(ctx);
+        }},
+        {keywords::compile_batch, [&]() {
+            config.compile_batch = (size_t)read_number(ctx);
+        }},
+        {keywords::compile_batch_time, [&]() {
+            config.compile_batch_time = read_number(ctx);
+        }},
+        {keywords::archive, [&]() {
+            auto token = ctx.advance();
+            if(token.match<token_type::name>("thin")) {
+                config.thin_archive = true;
+            }
+            else if (token.match<token_type::name>("full")) {
+                config.thin_archive = false;
+            }
+            else {
+                throw std::runtime_error("Invalid archive value(thin|full): " + token.str());
+            }
+        }},
+        {keywords::visibility, [&]() {
+            auto token = ctx.advance();
+            if(token.match<token_type::name>("hidden")) {
+                config.hidden_visibility = true;
+            }
+            else if (token.match<token_type::name>("default")) {
+                config.hidden_visibility = false;
+            }
+            else {
+                throw std::runtime_error("Invalid visibility value(hidden|default): " + token.str());
+            }
+        }},
+        {keywords::version_script, [&]() {
+            config.version_script = read_name(ctx);
+        }},
+        {keywords::linker, [&]() {
+            config.linker = read_name(ctx);
+        }},
+        {keywords::partial_link, [&]() {
+            auto token = ctx.advance();
+            if(token.match<token_type::name>("directory")) {
+                config.partial_link = true;
+            }
+            else if (token.match<token_type::name>("off")) {
+                config.partial_link = false;
+            }
+            else {
+                throw std::runtime_error("Invalid partial_link value(directory|off): " + token.str());
+            }
+        }},
+        {keywords::debug_info, [&]() {
+            for (auto& mode : read_name_list(ctx))
+            {
+                if (mode == "split") {
+                    config.split_dwarf = true;
+                }
+                else if (mode == "compressed") {
+                    config.compress_debug = true;
+                }
+                else if (mode == "dwp") {
+                    config.package_dwarf = true;
+                }
+                else {
+                    throw std::runtime_error("Invalid debug_info value(split|compressed|dwp): " + mode);
+                }
+            }
+        }},
+        {keywords::pgo_train, [&]() {
+            config.pgo_train = read_name(ctx);
+        }},
+        {keywords::export_method, [&]() {
+            auto token = ctx.advance();
+            if(token.match<token_type::name>("hardlink")) {
+                config.export_hardlinks = true;
+            }
+            else if (token.match<token_type::name>("copy")) {
+                config.export_hardlinks = false;
+            }
+            else {
+                throw std::runtime_error("Invalid export_method value(copy|hardlink): " + token.str());
+            }
+        }},
+        {keywords::pool, [&]() {
+            auto name = read_name(ctx);
+            if (name != job_pool::compile && name != job_pool::link && name != job_pool::codegen && name != job_pool::tool) {
+                throw std::runtime_error("Invalid pool name(compile|link|codegen|tool): " + name);
+            }
+            config.pools[name] = (size_t)read_number(ctx);
+        }},
     };
 
     while (!ctx.eof()) {
@@ -194,4 +425,6 @@ void read_config(config& config, std::filesystem::path path)
     {
         config.source_folders.push_back("./src");
     }
+
+    resolve_libraries(config);
 }
\ No newline at end of file
@@ -4,14 +4,18 @@
 #include <string>
 #include <filesystem>
 #include <vector>
+#include <unordered_map>
 #include <iostream>
+#include "unity_build.hpp"
 
 #ifdef _WIN32
     const auto BIN_EXT = ".exe";
     const auto LIB_EXT = ".lib";
+    const auto SHARED_EXT = ".dll";
 #else
     const auto BIN_EXT = "";
     const auto LIB_EXT = ".a";
+    const auto SHARED_EXT = ".so";
 #endif
 
 enum class library_link_type
@@ -39,15 +43,38 @@ struct config{
     std::vector<std::string> link_etc;
     std::vector<std::string> macros;
     std::optional<std::string> asset_folder;
+    bool pack_assets = false; // export the asset folder as one indexed archive
+    bool compress_assets = false; // compress the packed assets that shrink
+    std::vector<std::string> dependencies;
+    bool pch = false;
+    double pch_threshold = 0.5; // fraction of the sources that must include a header
+    unity_mode unity = unity_mode::off;
+    size_t unity_batch_size = 512; // KB of source per unity batch
+    size_t unity_split_edits = 3; // edits after which a source leaves its batch
+    size_t compile_batch = 8; // sources per compiler invocation, 0 or 1 disables batching
+    double compile_batch_time = 1.0; // estimated seconds of work per batched invocation
 
     bool is_library = false;
-    size_t num_thread = 32;
+    bool thin_archive = false; // static libraries reference their objects instead of copying them
+    library_link_type link_type = library_link_type::_static;
+    bool hidden_visibility = false; // only symbols marked visible are exported by a shared library
+    std::optional<std::string> version_script; // path, or "auto" to generate it from the visible symbols
+    std::string linker = "auto"; // auto picks the fastest of mold, lld and gold
+    bool partial_link = false; // merge the objects of each directory before the final link
+    bool split_dwarf = false; // debug info in .dwo files next to the objects
+    bool compress_debug = false;
+    bool package_dwarf = false; // bundle the .dwo files in a .dwp when exporting
+    std::optional<std::string> pgo_train; // command exercising the pgo-generate binary
+    bool export_hardlinks = false; // exported files are hardlinks to the build outputs when on the same filesystem
+    size_t jobs = 0; // 0: derived from the available cpus
+    std::optional<double> max_load;
+    std::unordered_map<std::string, size_t> pools;
 
     std::filesystem::path get_binary_path() const
     {
         if (is_library)
         {
-            return std::filesystem::path("bin") / ("lib" + name + LIB_EXT);
+            return std::filesystem::path("bin") / ("lib" + name + (link_type == library_link_type::shared ? SHARED_EXT : LIB_EXT));
         }
         return std::filesystem::path("bin") / (name + BIN_EXT);
     }
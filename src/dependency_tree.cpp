@@ -4,7 +4,7 @@
 
 namespace fs = std::filesystem;
 
-std::optional<std::string> read_include(const std::string& line)
+std::optional<std::string> read_include(const std::string& line, bool& system)
 {
     const std::string includeText = "#include";
     size_t spos = line.find(includeText);
@@ -23,6 +23,7 @@ std::optional<std::string> read_include(const std::string& line)
     if(spos >= line_length) return std::nullopt;
 
     char d = line[spos];
+    system = d == '<';
     int dstart = spos + 1;
     spos++;
 
@@ -35,7 +36,7 @@ std::optional<std::string> read_include(const std::string& line)
     return std::nullopt;
 }
 
-std::vector<fs::path> read_dependencies(fs::path path, const std::vector<fs::path>& include_folders){
+std::vector<fs::path> read_dependencies(fs::path path, const std::vector<fs::path>& include_folders, std::vector<std::string>& system_includes){
     std::ifstream strm(path.c_str());
     std::string line;
     std::vector<fs::path> dependencies;
@@ -45,7 +46,8 @@ std::vector<fs::path> read_dependencies(fs::path path, const std::vector<fs::pat
     while (std::getline(strm, line))
     {
         // parse line
-        if (auto include = read_include(line); include.has_value())
+        bool system = false;
+        if (auto include = read_include(line, system); include.has_value())
         {
             fs::path rel(include.value());
             rel = path.parent_path() / rel;
@@ -56,14 +58,20 @@ std::vector<fs::path> read_dependencies(fs::path path, const std::vector<fs::pat
                 continue;
             }
 
+            bool found = false;
             for (auto& folder : include_folders)
             {
                 fs::path target = folder / include.value();
                 if (fs::exists(target))
                 {
                     dependencies.push_back(target);
+                    found = true;
                 }
             }
+            if (!found && system)
+            {
+                system_includes.push_back(include.value());
+            }
         }
     }
     strm.close();
@@ -92,8 +100,10 @@ void dependency_tree::add(std::filesystem::path file, const std::vector<fs::path
     {
         return;
     }
-    auto dependencies = read_dependencies(abs_file, include_folders);
+    std::vector<std::string> system_includes;
+    auto dependencies = read_dependencies(abs_file, include_folders, system_includes);
     _file_tree.emplace(abs_file.string(), dependencies);
+    _system_includes.emplace(abs_file.string(), system_includes);
     for (const auto& dep : dependencies)
     {
         add(dep, include_folders);
@@ -114,7 +124,7 @@ bool dependency_tree::need_rebuild(std::filesystem::path source, std::filesystem
     {
         return false;
     }
-    if (fs::last_write_time(source) > timestamp)
+    if (get_write_time(source) > timestamp)
     {
         //std::cout << source << " changed" << std::endl;
         return true;
@@ -141,6 +151,89 @@ bool dependency_tree::need_rebuild(std::filesystem::path source, std::filesystem
     return false;
 }
 
+fs::file_time_type dependency_tree::get_write_time(const fs::path& file)
+{
+    auto it = _write_times.find(file.string());
+    if (it == _write_times.end())
+    {
+        it = _write_times.emplace(file.string(), fs::last_write_time(file)).first;
+    }
+    return it->second;
+}
+
+bool dependency_tree::contains(const fs::path& file) const
+{
+    return _file_tree.contains(fs::absolute(file).lexically_normal().string());
+}
+
+size_t dependency_tree::get_closure_size(std::filesystem::path source)
+{
+    std::unordered_set<std::string> visited;
+    std::vector<fs::path> stack = { fs::absolute(source).lexically_normal() };
+    size_t size = 0;
+    while (!stack.empty())
+    {
+        auto current = stack.back();
+        stack.pop_back();
+        if (!visited.emplace(current.string()).second)
+        {
+            continue;
+        }
+        std::error_code error;
+        auto file_size = fs::file_size(current, error);
+        if (!error)
+        {
+            size += file_size;
+        }
+        if (auto it = _file_tree.find(current.string()); it != _file_tree.end())
+        {
+            for (auto& dependency : it->second)
+            {
+                stack.push_back(fs::absolute(dependency).lexically_normal());
+            }
+        }
+    }
+    return size;
+}
+
+std::unordered_map<std::string, size_t> dependency_tree::count_includes(const std::vector<std::filesystem::path>& sources)
+{
+    std::unordered_map<std::string, size_t> counts;
+    for (auto& source : sources)
+    {
+        auto root = fs::absolute(source).lexically_normal().string();
+        std::unordered_set<std::string> visited = { root };
+        std::unordered_set<std::string> system_includes;
+        std::vector<std::string> stack = { root };
+        while (!stack.empty())
+        {
+            auto current = stack.back();
+            stack.pop_back();
+            if (auto it = _system_includes.find(current); it != _system_includes.end())
+            {
+                system_includes.insert(it->second.begin(), it->second.end());
+            }
+            if (auto it = _file_tree.find(current); it != _file_tree.end())
+            {
+                for (auto& dependency : it->second)
+                {
+                    auto key = fs::absolute(dependency).lexically_normal().string();
+                    if (visited.emplace(key).second)
+                    {
+                        counts[key]++;
+                        stack.push_back(key);
+                    }
+                }
+            }
+        }
+        for (auto& include : system_includes)
+        {
+            counts["<" + include + ">"]++;
+        }
+    }
+    return counts;
+}
+
 void dependency_tree::print(std::ostream& output)
 {
     for (auto& file : _file_tree)
@@ -9,12 +9,23 @@
 class dependency_tree
 {
     std::unordered_map<std::string, std::vector<std::filesystem::path>> _file_tree;
+    // <...> includes that could not be found in the include folders, by file
+    std::unordered_map<std::string, std::vector<std::string>> _system_includes;
+    // headers are shared by many sources, each is checked once per build
+    std::unordered_map<std::string, std::filesystem::file_time_type> _write_times;
 
 public:
     void add(std::filesystem::path file, const std::vector<std::filesystem::path>& include_folders);
     bool need_rebuild(std::filesystem::path source, std::filesystem::file_time_type timestamp);
+    bool contains(const std::filesystem::path& file) const;
+    // Size in bytes of the file and every file it includes
+    size_t get_closure_size(std::filesystem::path source);
+    // Number of sources including each header, directly or not. Project
+    // headers are keyed by absolute path, system headers as <name>
+    std::unordered_map<std::string, size_t> count_includes(const std::vector<std::filesystem::path>& sources);
     void print(std::ostream& output);
  
 private:
+    std::filesystem::file_time_type get_write_time(const std::filesystem::path& file);
     bool need_rebuild(std::filesystem::path source, std::filesystem::file_time_type timestamp, std::unordered_set<std::string>& ignore);
 };
\ No newline at end of file
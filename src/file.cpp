@@ -8,9 +8,14 @@
 using namespace std;
 using uint = unsigned int;
 
-file::file(fs::path path, fs::path object_path, fs::path source_path, dependency_context& ctx){
+file::file(fs::path path, fs::path object_path, fs::path source_path){
     this->path = path;
     this->source_path = source_path;
+    relative_path = fs::relative(path, fs::current_path());
+    if (relative_path.empty())
+    {
+        relative_path = path;
+    }
 
     if(path.extension() == ".cpp" || path.extension() == ".c"){
         type = FILE_TYPE::SOURCE;
@@ -26,7 +31,6 @@ file::file(fs::path path, fs::path object_path, fs::path source_path, dependency
     }
 
     last_write = fs::last_write_time(path);
-    compute_dependencies(ctx);
 }
 
 bool file::read_include(const std::string& line, std::string& path)
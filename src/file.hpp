@@ -17,6 +17,7 @@ struct dependency_context
 
 class file{
     fs::path path;
+    fs::path relative_path; // to the working directory, looked up for every command
     fs::path source_path;
     FILE_TYPE type;
     std::vector<fs::path> dependencies;
@@ -24,18 +25,15 @@ class file{
 
 
     bool read_include(const std::string& line, std::string& path);
-    void compute_dependencies(dependency_context& ctx);
 
     public:
-    file(fs::path path, fs::path workspace_folder, fs::path source_path, dependency_context& ctx);
+    file(fs::path path, fs::path workspace_folder, fs::path source_path);
+    // Reads the includes of the file, only listed by verbose output
+    void compute_dependencies(dependency_context& ctx);
 
     bool rebuild_check(std::filesystem::file_time_type last_write, const std::vector<file>& files, std::set<fs::path>& checked) const;
     FILE_TYPE get_type() const { return type; }
-    fs::path get_file_path() const
-    {
-        auto relative = fs::relative(path, fs::current_path());
-        return relative.empty() ? path : relative;
-    }
+    const fs::path& get_file_path() const { return relative_path; }
     fs::path get_source_path() const { return source_path; }
     const std::vector<fs::path>& get_dependencies() { return dependencies; }
 
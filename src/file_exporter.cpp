@@ -0,0 +1,167 @@
+#include "file_exporter.hpp"
+#include <fstream>
+#include <memory>
+#include <optional>
+#include <sstream>
+#include <system_error>
+#include "utility/file_copy.hpp"
+#include "utility/hash.hpp"
+#include "utility/term.hpp"
+
+namespace fs = std::filesystem;
+
+namespace
+{
+    long long get_ticks(const fs::path& path)
+    {
+        return fs::last_write_time(path).time_since_epoch().count();
+    }
+}
+
+file_exporter::file_exporter(std::filesystem::path manifest, bool hardlinks) : _manifest(manifest), _hardlinks(hardlinks)
+{
+}
+
+void file_exporter::add(const std::filesystem::path& source, const std::filesystem::path& destination)
+{
+    _files.push_back({ fs::absolute(source).lexically_normal(), fs::absolute(destination).lexically_normal() });
+}
+
+void file_exporter::add_directory(const std::filesystem::path& source, const std::filesystem::path& destination)
+{
+    for (auto& item : fs::recursive_directory_iterator(source))
+    {
+        if (item.is_regular_file())
+        {
+            add(item.path(), destination / fs::relative(item.path(), source));
+        }
+    }
+}
+
+void file_exporter::load()
+{
+    _entries.clear();
+    std::ifstream file(_manifest);
+    std::string line;
+    while (std::getline(file, line))
+    {
+        // <hash> <size> <source time> <destination time> <destination>\t<source>
+        std::stringstream ss(line);
+        entry e;
+        std::string hash, paths;
+        ss >> hash >> e.size >> e.source_time >> e.destination_time;
+        std::getline(ss >> std::ws, paths);
+        auto tab = paths.find('\t');
+        if (ss.fail() || tab == std::string::npos)
+        {
+            continue;
+        }
+        e.hash = std::stoull(hash, nullptr, 16);
+        e.source = paths.substr(tab + 1);
+        _entries[paths.substr(0, tab)] = e;
+    }
+}
+
+void file_exporter::save()
+{
+    fs::create_directories(_manifest.parent_path());
+    std::ofstream file(_manifest);
+    for (auto& [destination, e] : _entries)
+    {
+        file << hash::to_hex(e.hash) << " " << e.size << " " << e.source_time << " " << e.destination_time << " "
+             << destination << "\t" << e.source << "\n";
+    }
+}
+
+bool file_exporter::is_unchanged(const export_file& file) const
+{
+    auto it = _entries.find(file.destination.string());
+    if (it == _entries.end() || it->second.source != file.source.string())
+    {
+        return false;
+    }
+    std::error_code code;
+    auto size = fs::file_size(file.source, code);
+    if (code || size != it->second.size || get_ticks(file.source) != it->second.source_time)
+    {
+        return false;
+    }
+    // the exported file must not have been touched since either
+    return fs::exists(file.destination, code) && fs::file_size(file.destination, code) == size
+        && get_ticks(file.destination) == it->second.destination_time;
+}
+
+std::vector<std::filesystem::path> file_exporter::run(scheduler& jobs, std::ostream& output)
+{
+    load();
+    std::vector<fs::path> written;
+    for (auto& file : _files)
+    {
+        if (is_unchanged(file))
+        {
+            continue;
+        }
+
+        std::optional<entry> previous;
+        if (auto it = _entries.find(file.destination.string()); it != _entries.end())
+        {
+            previous = it->second;
+        }
+        auto result = std::make_shared<entry>();
+        auto copied = std::make_shared<bool>(false);
+        scheduler::job job;
+        job.name = file.destination.string();
+        job.pool = job_pool::tool;
+        job.estimated_duration = 0.001;
+        job.action = [this, file, previous, result, copied](std::stringstream& output, Process::Stats&)
+            {
+                try
+                {
+                    result->source = file.source.string();
+                    result->size = fs::file_size(file.source);
+                    result->source_time = get_ticks(file.source);
+                    result->hash = hash::file(file.source).value_or(0);
+
+                    // same content as what was exported, or as what is already there
+                    std::error_code code;
+                    bool untouched = fs::exists(file.destination, code)
+                        && fs::file_size(file.destination, code) == result->size
+                        && (previous.has_value()
+                            ? previous->hash == result->hash && get_ticks(file.destination) == previous->destination_time
+                            : hash::file(file.destination) == result->hash);
+                    if (!untouched)
+                    {
+                        fs::create_directories(file.destination.parent_path());
+                        file_copy::copy(file.source, file.destination, _hardlinks);
+                        *copied = true;
+                    }
+                    result->destination_time = get_ticks(file.destination);
+                    return Process::Result::Success;
+                }
+                catch (fs::filesystem_error& error)
+                {
+                    output << error.what() << std::endl;
+                    return Process::Result::Failed;
+                }
+            };
+        job.on_finish = [this, &written, &output, result, copied](scheduler::job& job)
+            {
+                if (job.result == Process::Result::Failed)
+                {
+                    output << term::red << "Could not export " << job.name << ": " << job.output.str() << term::reset << std::flush;
+                    _entries.erase(job.name);
+                    return;
+                }
+                _entries[job.name] = *result;
+                if (*copied)
+                {
+                    written.push_back(job.name);
+                }
+            };
+        jobs.add(std::move(job));
+    }
+    jobs.run();
+    save();
+    _files.clear();
+    return written;
+}
@@ -0,0 +1,53 @@
+#pragma once
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+#include "scheduler.hpp"
+
+// Exports files to the install directories. A manifest in the object directory
+// records the size, write times and content hash of each exported file, so a
+// file unchanged since the last export is skipped without being read and a
+// rewritten file with the same content isn't copied again. Copies are reflinks
+// or in-kernel copies when the filesystem supports them, made in parallel.
+class file_exporter
+{
+    struct entry
+    {
+        std::string source;
+        uintmax_t size = 0;
+        long long source_time = 0;
+        long long destination_time = 0;
+        uint64_t hash = 0;
+    };
+
+    struct export_file
+    {
+        std::filesystem::path source;
+        std::filesystem::path destination;
+    };
+
+    std::filesystem::path _manifest;
+    bool _hardlinks;
+    std::map<std::string, entry> _entries; // by destination
+    std::vector<export_file> _files;
+
+public:
+    // Hardlinks replace copies when allowed and the destination is on the same filesystem
+    file_exporter(std::filesystem::path manifest, bool hardlinks);
+
+    void add(const std::filesystem::path& source, const std::filesystem::path& destination);
+    // Adds the files of a directory, keeping their paths relative to it
+    void add_directory(const std::filesystem::path& source, const std::filesystem::path& destination);
+
+    // Copies the files that changed in the tool pool, returns the destinations written.
+    // Failures are reported on output.
+    std::vector<std::filesystem::path> run(scheduler& jobs, std::ostream& output);
+
+private:
+    void load();
+    void save();
+    bool is_unchanged(const export_file& file) const;
+};
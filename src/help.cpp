@@ -27,17 +27,33 @@ std::vector<CommandHelp> get_all_commands() {
         {
             "build",
             "Build the C++ project (default command)",
-            "build [options]",
+            "build [targets...] [options]",
             {
+                {"targets", "Sources or directories to build, everything when omitted"},
+                {"--no-link", "Compile without linking"},
+                {"--syntax-only", "Check the stale sources with -fsyntax-only, no object is written"},
                 {"-v", "Verbose output"},
                 {"-fr", "Full rebuild"},
                 {"-fl", "Force linking"},
+                {"-d", "Build dependencies only"},
                 {"-g, --debug", "Debug build"},
                 {"--output-command", "Show build commands"},
                 {"-sw, --show-warning", "Show warnings"},
                 {"--print-dependencies", "Print dependency tree"},
-                {"-c <config>", "Specify config file (default: default.lzb)"},
-                {"--export-dir <dir>", "Export directory"}
+                {"-c <config>", "Specify config file (default: default.lzb), repeat to build several configs together"},
+                {"--export-dir <dir>", "Export directory"},
+                {"-j, --jobs <count>", "Maximum parallel jobs (default: available cpus)"},
+                {"-l, --max-load <load>", "Hold back new jobs while the load average is above this value"},
+                {"-p, --profile <name>", "Build profile with its own object tree: debug, release, lto, pgo-generate or pgo-use"}
+            }
+        },
+        {
+            "pgo",
+            "Build instrumented, run a training command and rebuild optimized with the profile",
+            "pgo [options]",
+            {
+                {"--train <command>", "Training command (default: pgo_train from the config)"},
+                {"-c <config>", "Specify config file (default: default.lzb)"}
             }
         },
         {
@@ -48,6 +64,36 @@ std::vector<CommandHelp> get_all_commands() {
                 {"output_file", "File to write build script to"}
             }
         },
+        {
+            "ninja",
+            "Generate a build.ninja building the project in parallel and incrementally",
+            "ninja [output_file] [options]",
+            {
+                {"output_file", "File to write the ninja build to (default: build.ninja)"},
+                {"-c <config>", "Specify config file (default: default.lzb)"}
+            }
+        },
+        {
+            "check",
+            "Check the syntax of the changed sources, most recently modified first",
+            "check [targets...] [options]",
+            {
+                {"targets", "Sources or directories to check, everything when omitted"},
+                {"--build", "Build after the checks, which still run first"},
+                {"-sw, --show-warning", "Show warnings"},
+                {"-c <config>", "Specify config file (default: default.lzb)"}
+            }
+        },
+        {
+            "stats",
+            "Report compile and link times recorded by previous builds",
+            "stats [options]",
+            {
+                {"-c <config>", "Specify config file (default: default.lzb)"},
+                {"-n <builds>", "Number of previous builds used to detect regressions (default: 5)"},
+                {"--top <count>", "Number of entries to show per section (default: 10)"}
+            }
+        },
         {
             "compile_commands",
             "Generate compile_commands.json for IDEs",
@@ -7,6 +7,7 @@
 #include "utility/args.hpp"
 #include "commands.hpp"
 #include "project.hpp"
+#include "build_stats.hpp"
 #include "help.hpp"
 #include <fstream>
 
@@ -78,9 +79,37 @@ int main(int argc, char** argv)
             {"build", [&]() {
                 ArgReader args(argc, argv);
                 build_options options(args);
+                options.read_targets(args);
+                if (auto configs = args.get_all("-c"); configs.size() > 1)
+                {
+                    std::vector<build_options> all;
+                    for (auto& config : configs)
+                    {
+                        all.push_back(options);
+                        all.back().config = config;
+                    }
+                    return project::build_all(all) == Process::Result::Failed ? EXIT_FAILURE : EXIT_SUCCESS;
+                }
                 project maker(options);
                 return maker.build() == Process::Result::Failed ? EXIT_FAILURE : EXIT_SUCCESS;
             }},
+            {"check", [&]() {
+                ArgReader args(argc, argv);
+                build_options options(args);
+                options.read_targets(args);
+                options.check_first = args.has("--build");
+                options.syntax_only = !options.check_first;
+                project maker(options);
+                return maker.build() == Process::Result::Failed ? EXIT_FAILURE : EXIT_SUCCESS;
+            }},
+            {"pgo", [&]() {
+                ArgReader args(argc, argv);
+                build_options options(args);
+                std::optional<std::string> training;
+                std::string arg_value;
+                if (args.get("--train", arg_value)) training = arg_value;
+                return pgo(options, training) ? EXIT_SUCCESS : EXIT_FAILURE;
+            }},
             {"script", [&]() {
                 if(argc != 3) {
                     std::cout << "Usage: " << argv[0] << " script <output_file>" << std::endl;
@@ -94,6 +123,28 @@ int main(int argc, char** argv)
                 file << maker.get_build_commands();
                 return EXIT_SUCCESS;
             }},
+            {"ninja", [&]() {
+                ArgReader args(argc, argv);
+                build_options options(args);
+                project maker(options);
+                auto positional = build_options::get_positional(args);
+                std::string output = positional.size() > 1 ? positional[1] : "build.ninja";
+                std::ofstream(output) << maker.get_ninja_file();
+                return EXIT_SUCCESS;
+            }},
+            {"stats", [&]() {
+                ArgReader args(argc, argv);
+                build_options options(args);
+                size_t window = 5;
+                size_t count = 10;
+                std::string arg_value;
+                if (args.get("-n", arg_value)) window = std::stoul(arg_value);
+                if (args.get("--top", arg_value)) count = std::stoul(arg_value);
+                build_stats stats(options.get_stats_path());
+                stats.load();
+                stats.report(std::cout, window, count);
+                return EXIT_SUCCESS;
+            }},
             {"compile_commands", [&]() {
                 ArgReader args(argc, argv);
                 build_options options(args);
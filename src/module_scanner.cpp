@@ -0,0 +1,120 @@
+#include "module_scanner.hpp"
+#include <fstream>
+#include <sstream>
+
+namespace fs = std::filesystem;
+
+static std::string strip_comments(std::istream& input)
+{
+    std::string result;
+    bool block = false;
+    std::string line;
+    while (std::getline(input, line))
+    {
+        for (size_t i = 0; i < line.size(); i++)
+        {
+            if (block)
+            {
+                if (line.compare(i, 2, "*/") == 0)
+                {
+                    block = false;
+                    i++;
+                }
+                continue;
+            }
+            if (line.compare(i, 2, "//") == 0)
+            {
+                break;
+            }
+            if (line.compare(i, 2, "/*") == 0)
+            {
+                block = true;
+                i++;
+                continue;
+            }
+            result += line[i];
+        }
+        result += '\n';
+    }
+    return result;
+}
+
+static bool is_name_char(char c)
+{
+    return std::isalnum((unsigned char)c) || c == '_' || c == '.' || c == ':';
+}
+
+// Reads "<name>;" and returns the name, empty if the statement is something else
+static std::string read_module_name(std::istream& input)
+{
+    std::string name;
+    input >> std::ws;
+    while (is_name_char((char)input.peek()))
+    {
+        name += (char)input.get();
+    }
+    input >> std::ws;
+    if (input.peek() != ';')
+    {
+        return "";
+    }
+    return name;
+}
+
+std::optional<module_unit> scan_module_unit(const fs::path& source)
+{
+    std::ifstream file(source);
+    std::stringstream text(strip_comments(file));
+    module_unit unit;
+    bool found = false;
+    std::string line;
+    while (std::getline(text, line))
+    {
+        std::stringstream statement(line);
+        std::string word;
+        statement >> word;
+        bool exported = word == "export";
+        if (exported)
+        {
+            statement >> word;
+        }
+        if (word == "module")
+        {
+            // "module;" opens the global module fragment, "module :private;" closes the interface
+            auto name = read_module_name(statement);
+            if (name.empty() || name[0] == ':')
+            {
+                continue;
+            }
+            found = true;
+            unit.name = name;
+            unit.is_interface = exported;
+            // an implementation unit implicitly imports its module
+            if (!exported && name.find(':') == std::string::npos)
+            {
+                unit.imports.push_back(name);
+            }
+        }
+        else if (word == "import")
+        {
+            auto name = read_module_name(statement);
+            if (name.empty())
+            {
+                continue;
+            }
+            found = true;
+            if (name[0] == ':')
+            {
+                // partitions are named after the module importing them
+                auto module = unit.name.value_or("");
+                name = module.substr(0, module.find(':')) + name;
+            }
+            unit.imports.push_back(name);
+        }
+    }
+    if (!found)
+    {
+        return std::nullopt;
+    }
+    return unit;
+}
@@ -0,0 +1,17 @@
+#pragma once
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <vector>
+
+// Module declarations of a C++20 translation unit
+struct module_unit
+{
+    std::optional<std::string> name; // module or partition declared by the unit
+    bool is_interface = false;       // declared with "export module", produces a BMI
+    std::vector<std::string> imports; // named modules and partitions, header units are ignored
+};
+
+// Reads the module preamble of a source without preprocessing it. Returns
+// nothing for sources that neither declare nor import a module
+std::optional<module_unit> scan_module_unit(const std::filesystem::path& source);
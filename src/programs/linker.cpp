@@ -0,0 +1,59 @@
+#include "linker.hpp"
+#include "../utility/cmd.hpp"
+#include <map>
+#include <mutex>
+#include <sstream>
+
+namespace linker
+{
+    bool is_available(const std::string& compiler, const std::string& name)
+    {
+        // the driver fails when it can't find ld.<name>
+        std::stringstream output;
+        return Process::Run(compiler + " -fuse-ld=" + name + " -Wl,--version", output) == Process::Result::Success;
+    }
+
+    std::string detect(const std::string& compiler)
+    {
+        static std::mutex mutex;
+        static std::map<std::string, std::string> detected;
+        std::lock_guard lock(mutex);
+        if (auto it = detected.find(compiler); it != detected.end())
+        {
+            return it->second;
+        }
+        std::string result;
+        for (auto name : { "mold", "lld", "gold" })
+        {
+            if (is_available(compiler, name))
+            {
+                result = name;
+                break;
+            }
+        }
+        detected[compiler] = result;
+        return result;
+    }
+
+    std::string get_flags(const std::string& name, size_t threads)
+    {
+        if (name.empty())
+        {
+            return "";
+        }
+        std::stringstream flags;
+        flags << "-fuse-ld=" << name;
+        if (threads > 0)
+        {
+            if (name == "mold" || name == "lld")
+            {
+                flags << " -Wl,--threads=" << threads;
+            }
+            else if (name == "gold")
+            {
+                flags << " -Wl,--threads -Wl,--thread-count=" << threads;
+            }
+        }
+        return flags.str();
+    }
+}
@@ -0,0 +1,12 @@
+#pragma once
+#include <string>
+
+namespace linker
+{
+    // Whether the compiler driver can link with this linker (-fuse-ld=<name>)
+    bool is_available(const std::string& compiler, const std::string& name);
+    // Fastest available linker among mold, lld and gold, empty for the default one
+    std::string detect(const std::string& compiler);
+    // Flags selecting the linker and how many threads it may use, 0 keeps its default
+    std::string get_flags(const std::string& name, size_t threads);
+}
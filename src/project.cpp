@@ -10,17 +10,30 @@
 #include <stdexcept>
 #include <thread>
 #include <vector>
+#include <unordered_set>
+#include <functional>
 #include "config.hpp"
 #include "file.hpp"
 #include "utility/cmd.hpp"
 #include "utility/term.hpp"
+#include "scheduler.hpp"
+#include "utility/host.hpp"
 #include "programs/git.hpp"
+#include "programs/linker.hpp"
+#include "asset_packer.hpp"
+#include "utility/hash.hpp"
+#include "utility/file_copy.hpp"
 #include "env.hpp"
 
 
 namespace fs = std::filesystem;
 using namespace std::chrono_literals;
 
+// peak memory assumed for a job without any history, in kilobytes, so a
+// first build is held back too when memory runs short
+const size_t default_compile_memory = 512 * 1024;
+const size_t default_link_memory = 1024 * 1024;
+
 fs::path compute_path(fs::path root, fs::path target)
 {
     return target.is_absolute() ? target : root / target;
@@ -35,6 +48,9 @@ build_options::build_options(const ArgReader& args)
     output_command = args.has("--output-command");
     show_warning = args.has("--show-warning") || args.has("-sw");
     print_dependencies = args.has("--print-dependencies");
+    dependencies_only = args.has("-d");
+    no_link = args.has("--no-link");
+    syntax_only = args.has("--syntax-only");
     std::string arg_value;
     if (args.get("-c", arg_value))
     {
@@ -48,357 +64,2235 @@ build_options::build_options(const ArgReader& args)
     {
         export_directory = arg_value;
     }
+    if(args.get("-j", arg_value) || args.get("--jobs", arg_value))
+    {
+        jobs = std::stoul(arg_value);
+    }
+    if(args.get("-l", arg_value) || args.get("--max-load", arg_value))
+    {
+        max_load = std::stod(arg_value);
+    }
+    if(args.get("-p", arg_value) || args.get("--profile", arg_value))
+    {
+        static const std::vector<std::string> profiles = { "debug", "release", "lto", "pgo-generate", "pgo-use" };
+        if (std::find(profiles.begin(), profiles.end(), arg_value) == profiles.end())
+        {
+            throw "Unknown profile " + arg_value + " (debug|release|lto|pgo-generate|pgo-use)";
+        }
+        profile = arg_value;
+        debug = debug || profile == "debug";
+    }
 }
 
-project::project(const ArgReader& args) : _options(args)
+std::vector<std::string> build_options::get_positional(const ArgReader& args)
 {
-    read_config(_config, compute_path(_options.root_directory, _options.config));
-    _obj_root = _options.root_directory / "obj" / fs::path(_options.config).stem();
-    build_file_registry();
+    const std::vector<std::string> value_flags = { "-c", "--export-dir", "-j", "--jobs", "-l", "--max-load", "-p", "--profile" };
+    return args.get_positional(value_flags);
 }
 
-project::project(const build_options& options, std::ostream& output) : _options(options), _output(output)
+void build_options::read_targets(const ArgReader& args)
 {
-    read_config(_config, compute_path(_options.root_directory, _options.config));
-    _obj_root = _options.root_directory / "obj" / fs::path(_options.config).stem();
-    build_file_registry();
+    auto positional = get_positional(args);
+    for (size_t i = 0; i < positional.size(); i++)
+    {
+        if (i == 0 && (positional[i] == "build" || positional[i] == "check"))
+        {
+            continue;
+        }
+        if (!fs::exists(positional[i]))
+        {
+            throw "Could not find target " + positional[i];
+        }
+        targets.push_back(fs::absolute(positional[i]).lexically_normal());
+    }
 }
 
-Process::Result project::build()
+project::project(const ArgReader& args) : _options(args), _stats(_options.get_stats_path()), _restat(_options.get_obj_root() / "restat"),
+    _scans(std::make_shared<scan_cache>())
 {
+    project_registry registry;
+    load(registry);
+}
 
-    if (_options.print_dependencies)
-    {
-        _dep_tree.print(_output);
-        return Process::Result::Success;
-    }
+project::project(const build_options& options, std::ostream& output) : _options(options), _output(output), _stats(_options.get_stats_path()), _restat(_options.get_obj_root() / "restat"),
+    _scans(std::make_shared<scan_cache>())
+{
+    project_registry registry;
+    load(registry);
+}
 
-    BuildStatus status = BuildStatus::NoChange;
-    fs::file_time_type last_write = fs::file_time_type::min();
+project::project(const build_options& options, std::ostream& output, project_registry& registry, std::shared_ptr<scan_cache> scans)
+    : _options(options), _output(output), _stats(_options.get_stats_path()), _restat(_options.get_obj_root() / "restat"), _scans(scans)
+{
+    load(registry);
+}
 
-    if (_header_only)
+// Paths in a config are relative to its project, make them usable from the
+// working directory when building a sub-project
+void rebase_paths(config& config, fs::path root)
+{
+    auto rebase = [&](std::string& path) { path = compute_path(root, path).lexically_normal().string(); };
+    std::for_each(config.include_folder.begin(), config.include_folder.end(), rebase);
+    std::for_each(config.library_paths.begin(), config.library_paths.end(), rebase);
+    std::for_each(config.source_folders.begin(), config.source_folders.end(), rebase);
+    std::for_each(config.exclude.begin(), config.exclude.end(), rebase);
+    if (config.asset_folder.has_value())
     {
-        _output << "Header only library ready" << std::endl;
-        return Process::Result::Success;
+        rebase(config.asset_folder.value());
     }
+    if (config.version_script.has_value() && config.version_script.value() != "auto")
+    {
+        rebase(config.version_script.value());
+    }
+}
 
-    status = compile_project_async(last_write);
-
-    if (status == BuildStatus::Failed)
+void project::load(project_registry& registry)
+{
+    auto config_path = compute_path(_options.root_directory, _options.config);
+    registry[fs::weakly_canonical(config_path).string()] = nullptr;
+    read_config(_config, config_path);
+    if (!fs::equivalent(_options.root_directory, fs::current_path()))
     {
-        _output << term::red << "Build failed" << term::reset << std::endl;
-        return Process::Result::Failed;
+        rebase_paths(_config, _options.root_directory);
     }
+    _obj_root = _options.get_obj_root();
+    load_dependencies(registry);
+}
 
-    if (!_options.force_linking && !binary_requires_rebuild(last_write))
+std::vector<file>& project::get_files()
+{
+    if (!_files_listed)
     {
-        _output << "Binary is up to date." << std::endl;
-        return Process::Result::Success;
+        build_file_registry();
+        _files_listed = true;
     }
+    return _files;
+}
 
-    _output << "Creating " << (is_library() ? "library" : "executable") << "..." << std::endl;
-    
-    auto binary_path = compute_path(_options.root_directory, _config.get_binary_path());
-    auto cmd = get_link_command(binary_path.string());
-    
-    if(_options.output_command) _output << cmd << std::endl;
-    std::stringstream output;
-    if(Process::Run(cmd.c_str(), output) == Process::Result::Failed)
+dependency_tree& project::get_include_tree()
+{
+    if (!_dep_tree)
     {
-        std::cerr << term::red << "Error creating binary" << term::reset << std::endl;
-        _output << output.str() << std::flush;
-        return Process::Result::Failed;
+        get_files();
+        // the tree only depends on the include folders, sources already in it aren't read again
+        std::string key;
+        for (auto& folder : _dep_context.include_folders)
+        {
+            key += folder.string() + "\n";
+        }
+        auto& tree = _scans->trees[key];
+        if (!tree)
+        {
+            tree = std::make_shared<dependency_tree>();
+        }
+        _dep_tree = tree;
     }
-    return Process::Result::Success;
+    return *_dep_tree;
 }
 
-void project::export_binary(std::filesystem::path target)
+dependency_tree& project::get_dependency_tree()
 {
-    auto binary_path = compute_path(_options.root_directory, _config.get_binary_path());
-    fs::create_directories(target);
-    fs::path executable = target / binary_path.filename();
-    try
+    auto& tree = get_include_tree();
+    if (!_dependencies_scanned)
     {
-        if (fs::exists(executable))
+        for (auto& f : _files)
         {
-            if (fs::last_write_time(executable) > fs::last_write_time(binary_path))
+            if (f.get_type() == FILE_TYPE::SOURCE)
             {
-                return;
+                tree.add(f.get_file_path(), _dep_context.include_folders);
             }
-            fs::remove(executable);
         }
-        fs::copy(binary_path, executable);
-        _output << term::green << "Exported " << binary_path << " to " << executable << term::green << std::endl;
-    }
-    catch (fs::filesystem_error& error)
-    {
-        std::cerr << term::red << "Could not export executable: " << error.what() << term::reset << std::endl;
+        _dependencies_scanned = true;
     }
+    return tree;
 }
 
-void project::build_file_registry()
+bool project::is_stale(const std::filesystem::path& source, fs::file_time_type time)
 {
-    _files.clear();
-    fs::path obj_dir(_options.root_directory / "obj");
-    if(!fs::exists(obj_dir)){
-        fs::create_directory(obj_dir);
+    auto& tree = get_include_tree();
+    tree.add(source, _dep_context.include_folders);
+    return tree.need_rebuild(source, time);
+}
+
+bool project::is_targeted(const file& unit)
+{
+    if (_options.targets.empty())
+    {
+        return true;
     }
-    fs::path bin_dir(_options.root_directory / "bin");
-    if(!fs::exists(bin_dir)){
-        fs::create_directory(bin_dir);
+    auto matches = [&](const fs::path& path)
+        {
+            auto absolute = fs::absolute(path).lexically_normal();
+            return std::any_of(_options.targets.begin(), _options.targets.end(), [&](auto& target)
+                {
+                    return std::mismatch(target.begin(), target.end(), absolute.begin(), absolute.end()).first == target.end();
+                });
+        };
+    if (matches(unit.get_file_path()))
+    {
+        return true;
+    }
+    // a unity source is targeted through the sources it batches
+    if (!_unity.has_value() || std::none_of(_unity_files.begin(), _unity_files.end(), [&](auto& f) { return &f == &unit; }))
+    {
+        return false;
     }
+    auto unit_path = fs::absolute(unit.get_file_path()).lexically_normal();
+    for (auto& f : get_files())
+    {
+        if (f.get_type() == FILE_TYPE::SOURCE && _unity->is_batched(f.get_file_path())
+            && fs::absolute(_unity->get_batch_source(f.get_file_path())).lexically_normal() == unit_path && matches(f.get_file_path()))
+        {
+            return true;
+        }
+    }
+    return false;
+}
 
-    dependency_context ctx;
-    for (auto& include_folder : _config.include_folder)
+void project::prepare_sources()
+{
+    if (_sources_prepared)
     {
-        ctx.include_folders.push_back(include_folder);
+        return;
     }
-    // TODO: fix for windows
-    if (std::filesystem::exists("/usr/include"))
+    _sources_prepared = true;
+    scan_modules();
+    if (_config.unity != unity_mode::off)
     {
-        ctx.include_folders.push_back("usr/include");
+        setup_unity();
     }
-    if(std::filesystem::exists(INCLUDE_EXPORT_PATH))
+    if (_config.pch)
     {
-        ctx.include_folders.push_back(INCLUDE_EXPORT_PATH);
+        setup_pch();
     }
-    for (auto& src_folder : _config.source_folders)
+}
+
+bool project::is_header_only()
+{
+    get_files();
+    return _header_only;
+}
+
+void project::load_dependencies(project_registry& registry)
+{
+    for (auto& dependency : _config.dependencies)
     {
-        auto root_folder = compute_path(_options.root_directory, src_folder);
-        auto it = fs::recursive_directory_iterator(root_folder);
-        for(decltype(it) end; it != end; ++it)
+        build_options options = _options;
+        options.print_dependencies = false;
+        options.dependencies_only = false;
+        fs::path path = compute_path(_options.root_directory, dependency);
+        if (path.extension() == ".lzb")
         {
-            if (_config.is_excluded(*it))
-            {
-                it.disable_recursion_pending();
-                continue;
-            }
-            if (fs::is_directory(*it))
+            options.root_directory = path.parent_path();
+            options.config = path.filename().string();
+        }
+        else
+        {
+            options.root_directory = path;
+            options.config = "default.lzb";
+        }
+        options.root_directory = fs::weakly_canonical(options.root_directory);
+        auto config_path = options.root_directory / options.config;
+        if (!fs::exists(config_path))
+        {
+            throw "Could not find dependency config " + config_path.string();
+        }
+
+        auto key = fs::weakly_canonical(config_path).string();
+        std::shared_ptr<project> sub_project;
+        if (auto it = registry.find(key); it != registry.end())
+        {
+            if (it->second == nullptr)
             {
-                continue;
+                throw "Dependency cycle on " + key;
             }
+            sub_project = it->second;
+        }
+        else
+        {
+            sub_project = std::shared_ptr<project>(new project(options, _output, registry, _scans));
+            registry[key] = sub_project;
+        }
+        _dependencies.push_back(sub_project);
 
+        // sub-project headers are visible to this project
+        auto add_include = [&](std::string include)
+            {
+                if (std::find(_config.include_folder.begin(), _config.include_folder.end(), include) == _config.include_folder.end())
+                {
+                    _config.include_folder.push_back(include);
+                }
+            };
+        for (auto& include : sub_project->_config.include_folder)
+        {
+            add_include(include);
+        }
+        for (auto& source : sub_project->_config.source_folders)
+        {
+            add_include(compute_path(options.root_directory, source).lexically_normal().string());
+        }
+    }
+}
 
-            fs::path relative_path = fs::relative(*it, _options.root_directory);
-            relative_path.replace_extension(".o");
-            _files.push_back(file(*it, _options.root_directory, fs::relative(*it, root_folder), ctx));
-            if(_options.verbose){
-                _output << _files.back() << std::endl;
-            }
-            auto& file = _files.back();
-            if (file.get_type() == FILE_TYPE::SOURCE)
+std::vector<std::filesystem::path> project::get_external_libraries()
+{
+    std::vector<fs::path> libraries;
+    for (auto path : _config.library_paths)
+    {
+        auto lib_path = compute_path(_options.root_directory, path);
+        for (auto lib : _config.libraries)
+        {
+            fs::path full_path = fs::path(lib_path) / ("lib" + lib.name + LIB_EXT);
+            if (fs::exists(full_path))
             {
-                _dep_tree.add(file.get_file_path(), ctx.include_folders);
-                _header_only = false;
+                libraries.push_back(full_path);
             }
         }
     }
+    return libraries;
 }
 
-std::string project::get_build_commands()
+std::vector<std::filesystem::path> project::get_dependency_libraries()
 {
-    std::stringstream ss;
-    // std::vector<std::string> source_files;
-    for(auto& file: _files)
+    // static libraries have to come after everything that uses them
+    std::vector<fs::path> libraries;
+    for (auto& dependency : _dependencies)
     {
-        if(file.get_type() == FILE_TYPE::SOURCE)
+        if (dependency->is_library() && !dependency->is_header_only())
         {
-            // source_files.push_back(fs::relative(file.get_file_path()));
-            auto output_file = std::filesystem::relative(get_object_path(file));
-            auto cmd = get_object_compilation_command(file);
-            ss << "echo \"" << cmd << "\"" << std::endl;
-            ss << "mkdir -p " << output_file.remove_filename() << std::endl;
-            ss << cmd << std::endl;
+            libraries.push_back(compute_path(dependency->_options.root_directory, dependency->_config.get_binary_path()));
         }
+        auto sub_libraries = dependency->get_dependency_libraries();
+        libraries.insert(libraries.end(), sub_libraries.begin(), sub_libraries.end());
     }
-    auto binary_path = fs::relative(compute_path(_options.root_directory, _config.get_binary_path()));
-    auto cmd = get_link_command(binary_path.string());
-    ss << "echo \"" << cmd << "\"" << std::endl;
-    ss << "mkdir -p " << std::filesystem::relative(binary_path) << std::endl;
-    ss << cmd << std::endl;
-    return ss.str();
+    std::vector<fs::path> result;
+    for (size_t i = 0; i < libraries.size(); i++)
+    {
+        if (std::find(libraries.begin() + i + 1, libraries.end(), libraries[i]) == libraries.end())
+        {
+            result.push_back(libraries[i]);
+        }
+    }
+    return result;
 }
 
-void project::export_header_files(std::filesystem::path target)
+Process::Result project::build()
 {
-    fs::create_directories(target);
-    for (auto& file : _files)
+
+    if (_options.print_dependencies)
     {
-        if (file.get_type() == FILE_TYPE::HEADER)
+        get_dependency_tree().print(_output);
+        return Process::Result::Success;
+    }
+
+    if (is_header_only() && _dependencies.empty())
+    {
+        _output << "Header only library ready" << std::endl;
+        return Process::Result::Success;
+    }
+
+    scheduler jobs(_output, get_job_limit());
+    configure_scheduler(jobs);
+    schedule(jobs);
+    jobs.run();
+    jobs.print_summary(_output);
+    return finish_build(jobs);
+}
+
+Process::Result project::build_all(const std::vector<build_options>& configs, std::ostream& output)
+{
+    project_registry registry;
+    auto scans = std::make_shared<scan_cache>();
+    std::vector<std::shared_ptr<project>> projects;
+    for (auto& options : configs)
+    {
+        auto config_path = compute_path(options.root_directory, options.config);
+        if (!fs::exists(config_path))
         {
-            auto path = file.get_source_path();
-            auto dest_path = target / _config.name / path;
-            if (fs::exists(dest_path))
-            {
-                if (fs::last_write_time(dest_path) > fs::last_write_time(file.get_file_path()))
-                {
-                    // ignore if dest file is more recent than current file
-                    continue;
-                }
-                fs::remove(dest_path);
-            }
-            fs::create_directories(dest_path.parent_path());
-            fs::copy(file.get_file_path(), dest_path);
-            _output << term::green << "Exported " << file.get_file_path() << " to " << dest_path << term::reset << std::endl;
+            throw "Could not find config " + config_path.string();
+        }
+        // a configuration may already be loaded as a dependency of another
+        auto key = fs::weakly_canonical(config_path).string();
+        auto& loaded = registry[key];
+        if (!loaded)
+        {
+            loaded = std::shared_ptr<project>(new project(options, output, registry, scans));
+        }
+        projects.push_back(registry[key]);
+    }
+
+    // the first configuration sets the job limit and the pools
+    scheduler jobs(output, projects.front()->get_job_limit());
+    projects.front()->configure_scheduler(jobs);
+    for (auto& p : projects)
+    {
+        p->schedule(jobs);
+    }
+    jobs.run();
+    jobs.print_summary(output);
+    auto result = Process::Result::Success;
+    for (auto& p : projects)
+    {
+        if (p->finish_build(jobs) == Process::Result::Failed)
+        {
+            result = Process::Result::Failed;
         }
     }
+    return result;
+}
+
+void project::begin_build(std::chrono::steady_clock::time_point start)
+{
+    _build_start = start;
+    _status = BuildStatus::NoChange;
+    _last_write = fs::file_time_type::min();
+    _stats.load();
+    _stats.begin_build();
+    _restat.load();
+}
+
+void project::configure_scheduler(scheduler& jobs)
+{
+    jobs.set_max_load(_options.max_load.has_value() ? _options.max_load : _config.max_load);
+    for (auto& [pool, limit] : _config.pools)
+    {
+        jobs.set_pool_limit(pool, limit);
+    }
 }
 
-BuildStatus project::compile_project_async(fs::file_time_type& last_write)
+std::vector<size_t> project::schedule(scheduler& jobs, bool is_root)
 {
-    struct task
+    if (_scheduled)
     {
-        file* target_file;
-        std::future<Process::Result> result;
-        std::stringstream output;
-        bool finished = false;
-        Process::Result status = Process::Result::Success;
-    };
-    BuildStatus status = BuildStatus::NoChange;
+        return _ready_jobs;
+    }
+    _scheduled = true;
 
-    std::vector<task> tasks;
-    for (auto& f : _files)
+    std::vector<size_t> dependency_jobs;
+    for (auto& dependency : _dependencies)
     {
-        if (f.get_type() == FILE_TYPE::SOURCE)
-        {
-            auto obj_file_path = get_object_path(f);
-            bool should_rebuild = _options.full_rebuild
-                || !fs::exists(obj_file_path)
-                || _dep_tree.need_rebuild(f.get_file_path(), fs::last_write_time(obj_file_path));
-            
-            if (should_rebuild)
-            {
-                status = BuildStatus::Changed;
+        auto ids = dependency->schedule(jobs, false);
+        dependency_jobs.insert(dependency_jobs.end(), ids.begin(), ids.end());
+    }
 
-                task task;
-                task.target_file = &f;
-                tasks.push_back(std::move(task));
-            }
-            else if (_options.verbose)
+    if (is_header_only() || (is_root && _options.dependencies_only))
+    {
+        _ready_jobs = dependency_jobs;
+        return _ready_jobs;
+    }
+
+    prepare_sources();
+    begin_build(jobs.get_start());
+    _build_started = true;
+    // objects of another profile sharing the tree are rebuilt
+    std::string tree_profile;
+    std::getline(std::ifstream(_obj_root / "profile.stamp"), tree_profile);
+    if (tree_profile != _options.profile && fs::exists(_obj_root / "profile.stamp"))
+    {
+        _options.full_rebuild = true;
+    }
+    // targeted builds leave the unity batches as they are, and only real
+    // builds count edits, a source checked repeatedly was edited once
+    if (_unity.has_value() && _options.targets.empty() && !_options.syntax_only)
+    {
+        count_unity_edits();
+    }
+    _stats.set_pch(_pch_header.has_value());
+    // checks use the build's flags, with them the compiler would read an out
+    // of date precompiled header, so they also wait for the pch job
+    auto pch_job = schedule_pch_job(jobs);
+    if (_options.syntax_only || _options.check_first)
+    {
+        for (auto source : get_dirty_sources())
+        {
+            auto id = schedule_syntax_check_job(jobs, *source, pch_job);
+            if (_options.syntax_only)
             {
-                _output << term::blue << "Skipped " << f.get_file_path() << term::reset << std::endl;
+                _ready_jobs.push_back(id);
             }
         }
     }
+    if (_options.syntax_only)
+    {
+        if (pch_job.has_value())
+        {
+            _ready_jobs.push_back(pch_job.value());
+        }
+        _ready_jobs.insert(_ready_jobs.end(), dependency_jobs.begin(), dependency_jobs.end());
+        return _ready_jobs;
+    }
+    _compile_jobs = schedule_compile_jobs(jobs, pch_job);
+    if (_options.no_link)
+    {
+        _ready_jobs = _compile_jobs;
+        _ready_jobs.insert(_ready_jobs.end(), dependency_jobs.begin(), dependency_jobs.end());
+        return _ready_jobs;
+    }
+    // a link only waits on its own objects and the libraries it links
+    auto link_dependencies = _compile_jobs;
+    link_dependencies.insert(link_dependencies.end(), dependency_jobs.begin(), dependency_jobs.end());
+    if (uses_partial_link())
+    {
+        // detected here, the merges run in parallel
+        get_linker();
+        for (auto& [partial, members] : get_partial_objects())
+        {
+            link_dependencies.push_back(schedule_partial_link_job(jobs, partial, members, _compile_jobs));
+        }
+    }
+    _link_job = schedule_link_job(jobs, link_dependencies);
+    _ready_jobs = { _link_job.value() };
+    return _ready_jobs;
+}
 
-    std::mutex task_mutex;
-    size_t running = 0;
-    bool finished = false;
+Process::Result project::finish_build(scheduler& jobs)
+{
+    if (_finished)
+    {
+        return _status == BuildStatus::Failed ? Process::Result::Failed : Process::Result::Success;
+    }
+    _finished = true;
 
-    auto handle_result = [&]()
+    auto result = Process::Result::Success;
+    for (auto& dependency : _dependencies)
+    {
+        if (dependency->finish_build(jobs) == Process::Result::Failed)
         {
-            size_t finished_task = 0;
-            while (finished_task < tasks.size())
-            {
-                for (size_t i = 0; i < tasks.size(); i++)
-                {
-                    auto& t = tasks.at(i);
-                    if (!t.finished && t.result.valid() && t.result.wait_for(0s) == std::future_status::ready)
-                    {
-                        task_mutex.lock();
-                        running--;
-                        task_mutex.unlock();
-                        finished_task++;
-                        t.finished = true;
-                        _output << term::cyan << "Rebuilding " << t.target_file->get_file_path() << ": " << term::reset << std::flush;
-                        auto result = t.result.get();
-                        t.status = result;
-                        if (result == Process::Result::Failed)
-                        {
-                            status = BuildStatus::Failed;
-                            _output << term::red << "Failed " << term::reset << std::endl;
-                        }
-                        else
-                        {
-                            _output << term::green << "Rebuilt" << term::reset << std::endl;
-                        }
-                        auto target_obj_file = get_object_path(*t.target_file);
-                        if (fs::exists(target_obj_file))
-                        {
-                            auto file_last_write = fs::last_write_time(target_obj_file);
-                            if(file_last_write > last_write){
-                                last_write = file_last_write;
-                            }
-                        }
-                    }
-                }
-            }
-            finished = true;
-        };
+            result = Process::Result::Failed;
+        }
+    }
+    if (!_build_started)
+    {
+        return result;
+    }
 
-    auto start_task_handler = [&]()
+    for (auto id : _compile_jobs)
+    {
+        auto& job = jobs.get(id);
+        if (job.result == Process::Result::Failed)
+        {
+            _output << term::red << job.name << " Failed:" << term::reset << std::endl;
+            _output << job.output.str() << std::endl;
+        }
+        else if (_options.show_warning)
         {
-            for (size_t i = 0; i < tasks.size(); i++)
+            auto output = job.output.str();
+            if (output.size() > 0)
             {
-                while (running >= _config.num_thread)
-                {
-                    std::this_thread::sleep_for(std::chrono::duration<double>(0.1s));
-                }
-                task_mutex.lock();
-                running++;
-                auto& t = tasks.at(i);
-                t.result = std::async(std::launch::async, &project::compile_object, this, std::ref(*t.target_file), std::ref(t.output));
-                task_mutex.unlock();
+                _output << term::yellow << job.name << " has warning:" << term::reset << std::endl;
+                _output << output << std::endl;
             }
-        };
+        }
+    }
 
-    std::thread processing(handle_result);
-    std::thread starter(start_task_handler);
-    
-    starter.join();
-    processing.join();
+    // a syntax check says nothing about build times
+    if (!_options.syntax_only)
+    {
+        _stats.end_build(get_build_time());
+        _stats.save();
+    }
+    _restat.save();
 
-    for (auto& t : tasks)
+    if (_status == BuildStatus::Failed)
     {
-        if (t.status == Process::Result::Failed)
-        {
-            _output << term::red << t.target_file->get_file_path() << " Failed:" << term::reset << std::endl;
-            _output << t.output.str() << std::endl;
-        }
-        else if (_options.show_warning)
+        _output << term::red << "Build failed: " << _config.name << term::reset << std::endl;
+        return Process::Result::Failed;
+    }
+    if (_link_job.has_value() && jobs.get(_link_job.value()).result == Process::Result::Failed)
+    {
+        _status = BuildStatus::Failed;
+        return Process::Result::Failed;
+    }
+    // the objects outside the targets may still come from another profile
+    if (_options.targets.empty() && !_options.syntax_only)
+    {
+        std::ofstream(_obj_root / "profile.stamp") << _options.profile << std::endl;
+    }
+    if (_options.profile == "pgo-use" && (!fs::exists(get_profile_data()) || fs::is_empty(get_profile_data())))
+    {
+        _output << term::yellow << "No profile data in " << get_profile_data() << ", run lzbuild pgo" << term::reset << std::endl;
+    }
+    return result;
+}
+
+void project::export_binary(std::filesystem::path target)
+{
+    auto binary_path = compute_path(_options.root_directory, _config.get_binary_path());
+    fs::create_directories(target);
+    fs::path executable = target / binary_path.filename();
+    try
+    {
+        if (is_library() && _config.thin_archive)
+        {
+            if (fs::exists(executable))
+            {
+                if (fs::last_write_time(executable) > fs::last_write_time(binary_path))
+                {
+                    return;
+                }
+                fs::remove(executable);
+            }
+            // a thin archive only references the objects, export a full copy
+            std::stringstream command;
+            command << get_archiver() << " rcs " << executable.string();
+            for (auto unit : get_translation_units())
+            {
+                command << " " << fs::relative(get_object_path(*unit)).string();
+            }
+            std::stringstream output;
+            if (Process::Run(command.str(), output) == Process::Result::Failed)
+            {
+                std::cerr << term::red << "Could not export library: " << output.str() << term::reset << std::endl;
+                return;
+            }
+        }
+        else
+        {
+            file_exporter exporter(_obj_root / "export", _config.export_hardlinks);
+            exporter.add(binary_path, executable);
+            if (run_export(exporter).empty())
+            {
+                return;
+            }
+        }
+        _output << term::green << "Exported " << binary_path << " to " << executable << term::green << std::endl;
+        std::string dwo_files;
+        for (auto unit : get_translation_units())
+        {
+            if (auto dwo = get_object_path(*unit).replace_extension(".dwo"); fs::exists(dwo))
+            {
+                dwo_files += " " + fs::relative(dwo).string();
+            }
+        }
+        if (_config.split_dwarf && _config.package_dwarf && !(is_library() && !is_shared()) && !dwo_files.empty())
+        {
+            // gdb looks for <binary>.dwp next to the binary. The .dwo files are
+            // listed rather than read from the binary (dwp -e), which doesn't
+            // handle DWARF 5 everywhere
+            auto package = executable;
+            package += ".dwp";
+            std::stringstream output;
+            if (Process::Run("dwp -o " + package.string() + dwo_files, output) == Process::Result::Failed)
+            {
+                std::cerr << term::red << "Could not package debug info: " << output.str() << term::reset << std::endl;
+            }
+            else
+            {
+                _output << term::green << "Packaged debug info in " << package << term::reset << std::endl;
+            }
+        }
+    }
+    catch (fs::filesystem_error& error)
+    {
+        std::cerr << term::red << "Could not export executable: " << error.what() << term::reset << std::endl;
+    }
+}
+
+void project::build_file_registry()
+{
+    _files.clear();
+    fs::path obj_dir(_options.root_directory / "obj");
+    if(!fs::exists(obj_dir)){
+        fs::create_directory(obj_dir);
+    }
+    fs::path bin_dir(_options.root_directory / "bin");
+    if(!fs::exists(bin_dir)){
+        fs::create_directory(bin_dir);
+    }
+
+    dependency_context& ctx = _dep_context;
+    ctx.include_folders.clear();
+    for (auto& include_folder : _config.include_folder)
+    {
+        ctx.include_folders.push_back(include_folder);
+    }
+    // TODO: fix for windows
+    if (std::filesystem::exists("/usr/include"))
+    {
+        ctx.include_folders.push_back("usr/include");
+    }
+    if(std::filesystem::exists(INCLUDE_EXPORT_PATH))
+    {
+        ctx.include_folders.push_back(INCLUDE_EXPORT_PATH);
+    }
+
+    // configurations of the same sources share their listing
+    std::string key = _options.root_directory.string();
+    for (auto& folder : _config.source_folders)
+    {
+        key += "\n" + folder;
+    }
+    for (auto& exclude : _config.exclude)
+    {
+        key += "\n!" + exclude;
+    }
+    if (auto listing = _scans->listings.find(key); listing != _scans->listings.end())
+    {
+        _files = listing->second;
+        _header_only = std::none_of(_files.begin(), _files.end(), [](auto& f) { return f.get_type() == FILE_TYPE::SOURCE; });
+        return;
+    }
+
+    for (auto& src_folder : _config.source_folders)
+    {
+        auto root_folder = compute_path(_options.root_directory, src_folder);
+        auto it = fs::recursive_directory_iterator(root_folder);
+        for(decltype(it) end; it != end; ++it)
+        {
+            if (_config.is_excluded(*it))
+            {
+                it.disable_recursion_pending();
+                continue;
+            }
+            if (fs::is_directory(*it))
+            {
+                continue;
+            }
+
+
+            fs::path relative_path = fs::relative(*it, _options.root_directory);
+            relative_path.replace_extension(".o");
+            _files.push_back(file(*it, _options.root_directory, fs::relative(*it, root_folder)));
+            if(_options.verbose){
+                _files.back().compute_dependencies(ctx);
+                _output << _files.back() << std::endl;
+            }
+            if (_files.back().get_type() == FILE_TYPE::SOURCE)
+            {
+                _header_only = false;
+            }
+        }
+    }
+    _scans->listings[key] = _files;
+}
+
+std::string project::get_build_commands()
+{
+    prepare_sources();
+    std::stringstream ss;
+    if (_pch_header.has_value())
+    {
+        auto cmd = get_pch_command();
+        auto header = fs::relative(_pch_header.value());
+        ss << "mkdir -p " << header.parent_path() << std::endl;
+        ss << "cat > " << header << " << 'LZBUILD_PCH'" << std::endl;
+        ss << std::ifstream(_pch_header.value()).rdbuf();
+        ss << "LZBUILD_PCH" << std::endl;
+        ss << "echo \"" << cmd << "\"" << std::endl;
+        ss << cmd << std::endl;
+    }
+    for (auto& file : _unity_files)
+    {
+        auto path = fs::relative(file.get_file_path());
+        ss << "mkdir -p " << path.parent_path() << std::endl;
+        ss << "cat > " << path << " << 'LZBUILD_UNITY'" << std::endl;
+        ss << std::ifstream(file.get_file_path()).rdbuf();
+        ss << "LZBUILD_UNITY" << std::endl;
+    }
+    // std::vector<std::string> source_files;
+    for(auto unit : get_translation_units())
+    {
+        auto& file = *unit;
+        {
+            // source_files.push_back(fs::relative(file.get_file_path()));
+            auto output_file = std::filesystem::relative(get_object_path(file));
+            auto cmd = get_object_compilation_command(file);
+            ss << "echo \"" << cmd << "\"" << std::endl;
+            ss << "mkdir -p " << output_file.remove_filename() << std::endl;
+            ss << cmd << std::endl;
+        }
+    }
+    auto binary_path = fs::relative(compute_path(_options.root_directory, _config.get_binary_path()));
+    if (auto version_script = get_version_script(); version_script.has_value() && _config.version_script == "auto")
+    {
+        // generated during the build from the objects, the last one is reused
+        auto path = fs::relative(version_script.value());
+        ss << "cat > " << path << " << 'LZBUILD_VERSION_SCRIPT'" << std::endl;
+        ss << std::ifstream(version_script.value()).rdbuf();
+        ss << "LZBUILD_VERSION_SCRIPT" << std::endl;
+    }
+    auto cmd = get_link_command(binary_path.string(), false);
+    ss << "echo \"" << cmd << "\"" << std::endl;
+    ss << "mkdir -p " << std::filesystem::relative(binary_path).parent_path() << std::endl;
+    ss << cmd << std::endl;
+    return ss.str();
+}
+
+// Paths in build statements escape spaces and colons, values only dollars
+std::string ninja_escape(const std::string& text, bool path = true)
+{
+    std::string escaped;
+    for (auto c : text)
+    {
+        if (c == '$' || (path && (c == ' ' || c == ':')))
+        {
+            escaped += '$';
+        }
+        escaped += c;
+    }
+    return escaped;
+}
+
+// Command of a ninja statement writing a file lzbuild generates, so the
+// build doesn't depend on what lzbuild left in obj/
+std::string ninja_write_command(const std::filesystem::path& path)
+{
+    std::stringstream content;
+    content << std::ifstream(path).rdbuf();
+    std::string quoted;
+    for (auto c : content.str())
+    {
+        if (c == '\\') quoted += "\\\\";
+        else if (c == '\n') quoted += "\\n";
+        else if (c == '\'') quoted += "'\\''";
+        else quoted += c;
+    }
+    return "printf '%b' '" + ninja_escape(quoted, false) + "' > $out";
+}
+
+std::string project::get_ninja_file()
+{
+    std::stringstream ss;
+    ss << "# Generated by lzbuild ninja from " << _options.config << ", generate it again after changing the configuration." << std::endl;
+    ss << "ninja_required_version = 1.7" << std::endl;
+    ss << "builddir = " << ninja_escape(fs::relative(_obj_root).generic_string()) << std::endl << std::endl;
+
+    auto link_pool = _config.pools.find(job_pool::link);
+    ss << "pool compile" << std::endl << "  depth = " << get_job_limit() << std::endl;
+    ss << "pool link" << std::endl << "  depth = " << (link_pool != _config.pools.end() ? link_pool->second : 2) << std::endl << std::endl;
+
+    // $cmd holds the command lzbuild runs, the depfile is what ninja adds
+    ss << "rule compile" << std::endl;
+    ss << "  command = $cmd -MD -MF $out.d" << std::endl;
+    ss << "  depfile = $out.d" << std::endl;
+    ss << "  deps = gcc" << std::endl;
+    ss << "  description = Compiling $in" << std::endl;
+    ss << "  pool = compile" << std::endl << std::endl;
+    // the precompiled header, unity sources, module mapper and version script
+    ss << "rule generate" << std::endl;
+    ss << "  command = $cmd" << std::endl;
+    ss << "  description = Generating $out" << std::endl << std::endl;
+    // linkers always rewrite their output, restat would never prune anything
+    ss << "rule link" << std::endl;
+    ss << "  command = $cmd" << std::endl;
+    ss << "  description = Linking $out" << std::endl;
+    ss << "  pool = link" << std::endl << std::endl;
+    // ar only adds members, a fresh archive drops the removed ones
+    ss << "rule archive" << std::endl;
+    ss << "  command = rm -f $out && $cmd" << std::endl;
+    ss << "  description = Archiving $out" << std::endl;
+    ss << "  pool = link" << std::endl << std::endl;
+
+    std::unordered_set<const project*> written;
+    std::vector<std::string> defaults;
+    write_ninja_statements(ss, written, defaults);
+    ss << "default";
+    for (auto& target : defaults)
+    {
+        ss << " " << target;
+    }
+    ss << std::endl;
+    return ss.str();
+}
+
+void project::write_ninja_statements(std::ostream& output, std::unordered_set<const project*>& written, std::vector<std::string>& defaults)
+{
+    if (!written.insert(this).second)
+    {
+        return;
+    }
+    for (auto& dependency : _dependencies)
+    {
+        dependency->write_ninja_statements(output, written, defaults);
+    }
+    if (is_header_only())
+    {
+        return;
+    }
+    prepare_sources();
+
+    auto path = [](const fs::path& path) { return ninja_escape(fs::relative(path).generic_string()); };
+    output << "# " << _config.name << std::endl;
+    std::string pch;
+    if (_pch_header.has_value())
+    {
+        pch = path(get_pch_output());
+        output << "build " << path(_pch_header.value()) << ": generate" << std::endl;
+        output << "  cmd = " << ninja_write_command(_pch_header.value()) << std::endl;
+        output << "build " << pch << ": compile " << path(_pch_header.value()) << std::endl;
+        output << "  cmd = " << ninja_escape(get_pch_command(), false) << std::endl;
+    }
+
+    for (auto& file : _unity_files)
+    {
+        output << "build " << path(file.get_file_path()) << ": generate" << std::endl;
+        output << "  cmd = " << ninja_write_command(file.get_file_path()) << std::endl;
+    }
+    std::string mapper;
+    if (!_module_units.empty() && !is_clang())
+    {
+        mapper = path(_obj_root / "modules" / "mapper");
+        output << "build " << mapper << ": generate" << std::endl;
+        output << "  cmd = " << ninja_write_command(_obj_root / "modules" / "mapper") << std::endl;
+    }
+
+    // module units wait for the interfaces they import, gcc writes them through the mapper
+    std::unordered_map<const file*, std::string> objects;
+    for (auto unit : get_translation_units())
+    {
+        objects[unit] = path(get_object_path(*unit));
+    }
+    for (auto unit : get_translation_units())
+    {
+        auto module = _module_units.find(unit->get_file_path().string());
+        std::string implicit_outputs;
+        if (_options.debug && _config.split_dwarf)
+        {
+            implicit_outputs += " " + path(fs::path(get_object_path(*unit)).replace_extension(".dwo"));
+        }
+        // interfaces and partitions write their BMI, implementation units only read it
+        if (module != _module_units.end() && module->second.name.has_value()
+            && _module_providers.contains(module->second.name.value()) && _module_providers[module->second.name.value()] == unit)
+        {
+            implicit_outputs += " " + path(get_bmi_path(module->second.name.value()));
+        }
+        output << "build " << objects[unit];
+        if (!implicit_outputs.empty())
+        {
+            output << " |" << implicit_outputs;
+        }
+        output << ": compile " << path(unit->get_file_path());
+        if (uses_pch(*unit))
+        {
+            output << " | " << pch;
+        }
+        if (module != _module_units.end())
+        {
+            std::string imports = mapper.empty() ? "" : " " + mapper;
+            for (auto& import : module->second.imports)
+            {
+                if (auto provider = _module_providers.find(import); provider != _module_providers.end())
+                {
+                    imports += " " + objects[provider->second];
+                }
+            }
+            if (!imports.empty())
+            {
+                output << " ||" << imports;
+            }
+        }
+        output << std::endl << "  cmd = " << ninja_escape(get_object_compilation_command(*unit), false) << std::endl;
+    }
+
+    auto binary = compute_path(_options.root_directory, _config.get_binary_path());
+    if (auto version_script = get_version_script(); version_script.has_value() && _config.version_script == "auto" && is_shared())
+    {
+        // the symbols generate_version_script keeps, sorted the same way
+        auto filter = "$1 ~ /:$/ && $8 != \"\" && $7 != \"UND\" && $6 == \"DEFAULT\" && ($5 == \"GLOBAL\" || $5 == \"WEAK\")"
+            " && ($4 == \"FUNC\" || $4 == \"OBJECT\" || $4 == \"TLS\") { print $8 }";
+        auto script = "BEGIN { print \"" + get_version_node() + " {\" } NR == 1 { print \"  global:\" } { print \"    \" $0 \";\" }"
+            " END { print \"  local: *;\"; print \"};\" }";
+        output << "build " << path(version_script.value()) << ": generate";
+        for (auto unit : get_translation_units())
+        {
+            output << " " << objects[unit];
+        }
+        output << std::endl << "  cmd = readelf -sW $in | awk '" << ninja_escape(filter, false) << "' | LC_ALL=C sort -u | awk '"
+               << ninja_escape(script, false) << "' > $out" << std::endl;
+    }
+    output << "build " << path(binary) << ": " << (is_library() && !is_shared() ? "archive" : "link");
+    for (auto unit : get_translation_units())
+    {
+        output << " " << objects[unit];
+    }
+    if (!is_library() || is_shared())
+    {
+        std::string implicit;
+        for (auto& library : get_dependency_libraries())
+        {
+            implicit += " " + path(library);
+        }
+        if (auto version_script = get_version_script(); version_script.has_value() && is_shared())
+        {
+            implicit += " " + path(version_script.value());
+        }
+        if (!implicit.empty())
+        {
+            output << " |" << implicit;
+        }
+    }
+    output << std::endl << "  cmd = " << ninja_escape(get_link_command(binary.string(), false), false) << std::endl << std::endl;
+    defaults.push_back(path(binary));
+}
+
+void project::export_header_files(std::filesystem::path target)
+{
+    // an unchanged header keeps its timestamp, so its users aren't recompiled
+    file_exporter exporter(_obj_root / "export", _config.export_hardlinks);
+    for (auto& file : get_files())
+    {
+        if (file.get_type() == FILE_TYPE::HEADER)
+        {
+            exporter.add(file.get_file_path(), target / _config.name / file.get_source_path());
+        }
+    }
+    for (auto& path : run_export(exporter))
+    {
+        _output << term::green << "Exported " << path << term::reset << std::endl;
+    }
+}
+
+void project::setup_pch()
+{
+    std::vector<fs::path> sources;
+    for (auto& f : get_files())
+    {
+        if (f.get_type() == FILE_TYPE::SOURCE && f.get_file_path().extension() != ".c")
+        {
+            sources.push_back(f.get_file_path());
+        }
+    }
+    if (sources.size() < 2)
+    {
+        return;
+    }
+
+    // choosing the headers reads every include, a targeted build keeps the
+    // header of the last full build
+    auto path = _obj_root / "pch" / "pch.hpp";
+    if (!_options.targets.empty() && fs::exists(path))
+    {
+        std::ifstream header(path);
+        std::string line;
+        while (std::getline(header, line))
+        {
+            _pch_header_count += line.starts_with("#include") ? 1 : 0;
+        }
+        _pch_header = path;
+        _pch_users = sources.size();
+        return;
+    }
+
+    // headers reached by enough translation units, most shared first
+    std::vector<std::pair<std::string, size_t>> headers;
+    for (auto& [header, count] : get_dependency_tree().count_includes(sources))
+    {
+        if (count >= _config.pch_threshold * sources.size())
+        {
+            headers.push_back({header, count});
+        }
+    }
+    if (headers.empty())
+    {
+        return;
+    }
+    std::sort(headers.begin(), headers.end(), [](auto& a, auto& b)
+        {
+            return a.second != b.second ? a.second > b.second : a.first < b.first;
+        });
+
+    std::stringstream content;
+    content << "// Generated by lzbuild from the headers included by most sources" << std::endl;
+    content << "#pragma once" << std::endl;
+    for (auto& [header, count] : headers)
+    {
+        if (header.front() == '<')
+        {
+            content << "#include " << header << std::endl;
+        }
+        else
+        {
+            content << "#include \"" << fs::relative(header, path.parent_path()).generic_string() << "\"" << std::endl;
+        }
+    }
+
+    // only touch the header when its content changes, sources depend on its timestamp
+    std::stringstream previous;
+    previous << std::ifstream(path).rdbuf();
+    if (previous.str() != content.str())
+    {
+        fs::create_directories(path.parent_path());
+        std::ofstream(path) << content.str();
+    }
+    _pch_header = path;
+    _pch_users = sources.size();
+    _pch_header_count = headers.size();
+}
+
+bool project::uses_pch(const file& file)
+{
+    // a forced include would land before the module declaration. Only the
+    // users wait for the pch job, the others don't read the header while a
+    // failed job clears it.
+    return file.get_file_path().extension() != ".c" && !_module_units.contains(file.get_file_path().string())
+        && _pch_header.has_value();
+}
+
+std::filesystem::path project::get_pch_output()
+{
+    auto path = _pch_header.value();
+    path += _config.compiler.find("clang") != std::string::npos ? ".pch" : ".gch";
+    return path;
+}
+
+std::string project::get_pch_command()
+{
+    std::stringstream io;
+    io << "-x c++-header -o " << fs::relative(get_pch_output()) << " -c " << fs::relative(_pch_header.value());
+    return get_compile_command(_config.compiler, io.str());
+}
+
+std::optional<size_t> project::schedule_pch_job(scheduler& jobs)
+{
+    if (!_pch_header.has_value())
+    {
+        return std::nullopt;
+    }
+
+    auto output_path = get_pch_output();
+    auto command_path = _pch_header.value().parent_path() / "pch.cmd";
+    auto command = get_pch_command();
+    std::stringstream previous_command;
+    previous_command << std::ifstream(command_path).rdbuf();
+    bool should_rebuild = _options.full_rebuild
+        || !fs::exists(output_path)
+        || previous_command.str() != command
+        || is_stale(_pch_header.value(), fs::last_write_time(output_path));
+    if (!should_rebuild)
+    {
+        return std::nullopt;
+    }
+
+    scheduler::job job;
+    job.name = get_pretty_path(_pch_header.value()).string();
+    job.kind = job_kind::pch;
+    job.pool = job_pool::compile;
+    job.estimated_memory = default_compile_memory;
+    if (auto record = _stats.find_last(job_kind::pch, job.name); record.has_value())
+    {
+        job.estimated_duration = record->wall_time;
+        job.estimated_memory = record->peak_rss;
+    }
+    auto failed = std::make_shared<bool>(false);
+    job.action = [this, command, command_path, failed](std::stringstream& output, Process::Stats& stats)
+        {
+            if (_options.output_command) _output << std::endl << command << std::endl;
+            if (Process::Run(command.c_str(), output, stats) == Process::Result::Failed)
+            {
+                // sources still build, only slower
+                *failed = true;
+                return Process::Result::Success;
+            }
+            std::ofstream(command_path) << command;
+            return Process::Result::Success;
+        };
+    job.on_finish = [this, failed](scheduler::job& job)
+        {
+            _stats.record(job.kind, job.name, job.start, job.stats);
+            if (*failed)
+            {
+                // dependents are released after this, compiles never see the
+                // header half cleared nor pick up an outdated output
+                std::error_code error;
+                fs::remove(get_pch_output(), error);
+                _pch_header.reset();
+                _stats.set_pch(false);
+                _output << term::yellow << "Precompiled header failed, building without it:" << term::reset << std::endl;
+                _output << job.output.str() << std::endl;
+                return;
+            }
+            _output << term::cyan << "Precompiled " << _pch_header_count << " headers for " << _pch_users << " sources"
+                    << term::reset << " in " << job.stats.wall_time << "s, estimated saving "
+                    << job.stats.wall_time * (_pch_users - 1) << "s per full build" << std::endl;
+        };
+    return jobs.add(std::move(job));
+}
+
+void project::scan_modules()
+{
+    if (_modules_scanned)
+    {
+        return;
+    }
+    _modules_scanned = true;
+    for (auto& f : get_files())
+    {
+        if (f.get_type() != FILE_TYPE::SOURCE || f.get_file_path().extension() == ".c")
+        {
+            continue;
+        }
+        auto unit = scan_module_unit(f.get_file_path());
+        if (!unit.has_value())
+        {
+            continue;
+        }
+        // interfaces and partitions produce a BMI, plain implementation units don't
+        if (unit->name.has_value() && (unit->is_interface || unit->name->find(':') != std::string::npos))
+        {
+            if (_module_providers.contains(unit->name.value()))
+            {
+                throw std::string("Module " + unit->name.value() + " is declared by " + _module_providers[unit->name.value()]->get_file_path().string()
+                    + " and " + f.get_file_path().string());
+            }
+            _module_providers[unit->name.value()] = &f;
+        }
+        _module_units[f.get_file_path().string()] = unit.value();
+    }
+    if (_module_units.empty())
+    {
+        return;
+    }
+
+    // gcc finds every BMI through a mapper file, clang through the BMI directory
+    std::stringstream mapper;
+    for (auto& [name, provider] : _module_providers)
+    {
+        mapper << name << " " << fs::relative(get_bmi_path(name)).generic_string() << std::endl;
+    }
+    auto mapper_path = _obj_root / "modules" / "mapper";
+    fs::create_directories(mapper_path.parent_path());
+    std::stringstream previous;
+    previous << std::ifstream(mapper_path).rdbuf();
+    if (previous.str() != mapper.str())
+    {
+        std::ofstream(mapper_path) << mapper.str();
+    }
+}
+
+std::filesystem::path project::get_bmi_path(const std::string& module)
+{
+    auto name = module;
+    std::replace(name.begin(), name.end(), ':', '-');
+    bool clang = _config.compiler.find("clang") != std::string::npos;
+    return _obj_root / "modules" / (name + (clang ? ".pcm" : ".gcm"));
+}
+
+std::string project::get_module_flags(const file& file)
+{
+    auto module = _module_units.find(file.get_file_path().string());
+    if (module == _module_units.end())
+    {
+        return "";
+    }
+    std::stringstream flags;
+    if (_config.compiler.find("clang") != std::string::npos)
+    {
+        flags << " -fprebuilt-module-path=" << fs::relative(_obj_root / "modules").string();
+        if (module->second.name.has_value() && _module_providers.contains(module->second.name.value()))
+        {
+            flags << " -fmodule-output=" << fs::relative(get_bmi_path(module->second.name.value())).string() << " -x c++-module";
+        }
+    }
+    else
+    {
+        flags << " -fmodules-ts -fmodule-mapper=" << fs::relative(_obj_root / "modules" / "mapper").string();
+    }
+    return flags.str();
+}
+
+std::vector<const file*> project::sort_by_imports(const std::vector<const file*>& units)
+{
+    std::vector<const file*> sorted;
+    std::unordered_map<const file*, bool> visited; // false while the unit is being visited
+    std::function<void(const file*)> visit = [&](const file* unit)
+        {
+            if (auto it = visited.find(unit); it != visited.end())
+            {
+                if (!it->second)
+                {
+                    throw std::string("Module import cycle through " + unit->get_file_path().string());
+                }
+                return;
+            }
+            visited[unit] = false;
+            if (auto module = _module_units.find(unit->get_file_path().string()); module != _module_units.end())
+            {
+                for (auto& import : module->second.imports)
+                {
+                    // modules not provided by the project come from the compiler
+                    if (auto provider = _module_providers.find(import); provider != _module_providers.end())
+                    {
+                        visit(provider->second);
+                    }
+                }
+            }
+            visited[unit] = true;
+            sorted.push_back(unit);
+        };
+    for (auto unit : units)
+    {
+        visit(unit);
+    }
+    return sorted;
+}
+
+void project::setup_unity()
+{
+    _unity.emplace(_obj_root / "unity", _config.unity, _config.unity_batch_size * 1024, _config.unity_split_edits);
+    _unity->load();
+    std::vector<fs::path> sources;
+    for (auto& f : get_files())
+    {
+        // c sources can't share a translation unit with c++ ones, and module
+        // declarations can't be included
+        if (f.get_type() == FILE_TYPE::SOURCE && f.get_file_path().extension() != ".c"
+            && !_module_units.contains(f.get_file_path().string()))
+        {
+            sources.push_back(f.get_file_path());
+        }
+    }
+    _unity->update(sources);
+    write_unity_sources();
+}
+
+void project::write_unity_sources()
+{
+    _unity_files.clear();
+    for (auto& path : _unity->write_sources())
+    {
+        _unity_files.push_back(file(path, _options.root_directory, fs::relative(path, _obj_root)));
+    }
+}
+
+void project::count_unity_edits()
+{
+    // an edit is a batched source newer than the object of its batch, files
+    // edited often are compiled on their own so they stop dragging their batch along
+    bool split = false;
+    for (auto& f : get_files())
+    {
+        if (f.get_type() != FILE_TYPE::SOURCE || !_unity->is_batched(f.get_file_path()))
+        {
+            continue;
+        }
+        auto object = _obj_root / fs::relative(_unity->get_batch_source(f.get_file_path()), _obj_root).replace_extension(".o");
+        if (fs::exists(object) && fs::last_write_time(f.get_file_path()) > fs::last_write_time(object)
+            && _unity->record_edit(f.get_file_path()))
+        {
+            _output << term::cyan << "Moved " << f.get_file_path() << " out of its unity batch" << term::reset << std::endl;
+            split = true;
+        }
+    }
+    _unity->save();
+    if (split)
+    {
+        write_unity_sources();
+    }
+}
+
+std::vector<const file*> project::get_translation_units()
+{
+    std::vector<const file*> units;
+    for (auto& f : get_files())
+    {
+        if (f.get_type() == FILE_TYPE::SOURCE && !(_unity.has_value() && _unity->is_batched(f.get_file_path())))
+        {
+            units.push_back(&f);
+        }
+    }
+    for (auto& f : _unity_files)
+    {
+        units.push_back(&f);
+    }
+    return _module_units.empty() ? units : sort_by_imports(units);
+}
+
+std::vector<size_t> project::schedule_compile_jobs(scheduler& jobs, std::optional<size_t> pch_job)
+{
+    std::vector<const file*> stale;
+    std::unordered_set<const file*> stale_units;
+    for (auto unit : get_translation_units())
+    {
+        if (!is_targeted(*unit))
+        {
+            continue;
+        }
+        auto& f = *unit;
+        auto obj_file_path = get_object_path(f);
+        bool should_rebuild = _options.full_rebuild
+            || !fs::exists(obj_file_path)
+            || is_stale(f.get_file_path(), fs::last_write_time(obj_file_path))
+            || (uses_pch(f) && fs::last_write_time(_pch_header.value()) > fs::last_write_time(obj_file_path));
+
+        // units come after the modules they import, a unit is stale when one
+        // of its imports is rebuilt or has a newer interface
+        auto module = _module_units.find(f.get_file_path().string());
+        if (!should_rebuild && module != _module_units.end())
+        {
+            if (module->second.name.has_value() && _module_providers.contains(module->second.name.value()))
+            {
+                should_rebuild = !fs::exists(get_bmi_path(module->second.name.value()));
+            }
+            for (auto& import : module->second.imports)
+            {
+                auto provider = _module_providers.find(import);
+                if (provider == _module_providers.end())
+                {
+                    continue;
+                }
+                auto bmi = get_bmi_path(import);
+                should_rebuild = should_rebuild || stale_units.contains(provider->second)
+                    || (fs::exists(bmi) && fs::last_write_time(bmi) > fs::last_write_time(obj_file_path));
+            }
+        }
+
+        if (should_rebuild)
+        {
+            _status = BuildStatus::Changed;
+            stale.push_back(unit);
+            stale_units.insert(unit);
+        }
+        else if (_options.verbose)
+        {
+            _output << term::blue << "Skipped " << f.get_file_path() << term::reset << std::endl;
+        }
+    }
+
+    std::vector<size_t> ids;
+    // objects another configuration compiles with the same command are copied
+    std::vector<const file*> compiled;
+    std::unordered_map<const file*, std::string> shared_commands;
+    for (auto unit : stale)
+    {
+        auto command = get_shared_command(*unit);
+        if (!command.has_value())
+        {
+            compiled.push_back(unit);
+        }
+        else if (auto shared = _scans->objects.find(command.value()); shared != _scans->objects.end())
+        {
+            ids.push_back(schedule_shared_object_job(jobs, *unit, shared->second.first, shared->second.second));
+        }
+        else
+        {
+            compiled.push_back(unit);
+            shared_commands[unit] = command.value();
+        }
+    }
+
+    std::unordered_map<const file*, size_t> unit_jobs;
+    for (auto& batch : get_compile_batches(compiled))
+    {
+        if (batch.size() == 1)
+        {
+            ids.push_back(schedule_compile_job(jobs, *batch.front(), pch_job));
+            unit_jobs[batch.front()] = ids.back();
+        }
+        else
+        {
+            ids.push_back(schedule_batch_job(jobs, batch, pch_job));
+        }
+        for (auto unit : batch)
+        {
+            if (auto command = shared_commands.find(unit); command != shared_commands.end())
+            {
+                _scans->objects[command->second] = { ids.back(), get_object_path(*unit) };
+            }
+        }
+    }
+
+    // module units wait for the interfaces they import, the rest runs in parallel
+    for (auto& [unit, id] : unit_jobs)
+    {
+        auto module = _module_units.find(unit->get_file_path().string());
+        if (module == _module_units.end())
+        {
+            continue;
+        }
+        for (auto& import : module->second.imports)
+        {
+            auto provider = _module_providers.find(import);
+            if (provider != _module_providers.end() && unit_jobs.contains(provider->second))
+            {
+                jobs.get(id).dependencies.push_back(unit_jobs[provider->second]);
+            }
+        }
+    }
+    return ids;
+}
+
+size_t project::schedule_compile_job(scheduler& jobs, const file& f, std::optional<size_t> pch_job)
+{
+    scheduler::job job;
+    job.name = f.get_file_path().string();
+    job.kind = job_kind::compile;
+    job.pool = job_pool::compile;
+    if (pch_job.has_value() && uses_pch(f))
+    {
+        job.dependencies.push_back(pch_job.value());
+    }
+    job.estimated_duration = estimate_compile_time(f);
+    job.estimated_memory = estimate_compile_memory(f);
+    auto unchanged = std::make_shared<bool>(false);
+    job.action = [this, &f, unchanged](std::stringstream& output, Process::Stats& stats)
+        {
+            auto object = get_object_path(f);
+            auto before = _restat.take_snapshot(object);
+            auto result = compile_object(f, output, stats);
+            *unchanged = result == Process::Result::Success && _restat.compare(object, before);
+            return result;
+        };
+    job.on_finish = [this, &f, unchanged](scheduler::job& job)
+        {
+            if (job.skipped)
+            {
+                return;
+            }
+            _stats.record(job.kind, job.name, job.start, job.stats);
+            _output << term::cyan << "Rebuilding " << f.get_file_path() << ": " << term::reset << std::flush;
+            if (job.result == Process::Result::Failed)
+            {
+                _status = BuildStatus::Failed;
+                _output << term::red << "Failed " << term::reset << std::endl;
+            }
+            else
+            {
+                _output << term::green << (*unchanged ? "Unchanged" : "Rebuilt") << term::reset << std::endl;
+            }
+            // an object recompiled to the same bytes doesn't need a link
+            _last_write = std::max(_last_write, _restat.get_write_time(get_object_path(f)));
+        };
+    return jobs.add(std::move(job));
+}
+
+std::vector<const file*> project::get_dirty_sources()
+{
+    std::vector<std::pair<fs::file_time_type, const file*>> dirty;
+    for (auto& f : get_files())
+    {
+        if (f.get_type() != FILE_TYPE::SOURCE || !is_targeted(f))
+        {
+            continue;
+        }
+        // batched sources are checked on their own against the object of their batch
+        auto object = _unity.has_value() && _unity->is_batched(f.get_file_path())
+            ? _obj_root / fs::relative(_unity->get_batch_source(f.get_file_path()), _obj_root).replace_extension(".o")
+            : get_object_path(f);
+        if (_options.full_rebuild || !fs::exists(object) || is_stale(f.get_file_path(), fs::last_write_time(object)))
+        {
+            dirty.push_back({ fs::last_write_time(f.get_file_path()), &f });
+        }
+    }
+    std::stable_sort(dirty.begin(), dirty.end(), [](auto& a, auto& b) { return a.first > b.first; });
+    std::vector<const file*> sources;
+    for (auto& [time, source] : dirty)
+    {
+        sources.push_back(source);
+    }
+    return sources;
+}
+
+size_t project::schedule_syntax_check_job(scheduler& jobs, const file& f, std::optional<size_t> pch_job)
+{
+    scheduler::job job;
+    job.name = f.get_file_path().string();
+    job.kind = job_kind::compile;
+    job.pool = job_pool::compile;
+    job.urgent = true;
+    // the compiler would read the precompiled header while it is written
+    if (pch_job.has_value() && uses_pch(f))
+    {
+        job.dependencies.push_back(pch_job.value());
+    }
+    job.estimated_duration = estimate_compile_time(f);
+    job.estimated_memory = estimate_compile_memory(f);
+    job.action = [this, &f](std::stringstream& output, Process::Stats& stats)
+        {
+            // the flags of the real build so the diagnostics are the same, nothing
+            // is written. Built here, a failed pch job drops the forced include.
+            auto command = get_object_compilation_command(f) + " -fsyntax-only";
+            if (_options.output_command) _output << std::endl << command << std::endl;
+            return Process::Run(command.c_str(), output, stats);
+        };
+    job.on_finish = [this, &f](scheduler::job& job)
+        {
+            if (job.skipped)
+            {
+                return;
+            }
+            // not recorded in the stats, a syntax check is no compile time estimate
+            _output << term::cyan << "Checking " << f.get_file_path() << ": " << term::reset;
+            if (job.result == Process::Result::Failed)
+            {
+                _status = BuildStatus::Failed;
+                _output << term::red << "Failed " << term::reset << std::endl << job.output.str() << std::endl;
+            }
+            else
+            {
+                _output << term::green << "OK" << term::reset << std::endl;
+                if (_options.show_warning && job.output.tellp() > 0)
+                {
+                    _output << job.output.str() << std::endl;
+                }
+            }
+        };
+    return jobs.add(std::move(job));
+}
+
+std::optional<std::string> project::get_shared_command(const file& f)
+{
+    // split dwarf objects name their .dwo after the object
+    if (_options.debug && _config.split_dwarf)
+    {
+        return std::nullopt;
+    }
+    auto command = get_object_compilation_command(f);
+    std::stringstream output;
+    output << "-o " << fs::relative(get_object_path(f));
+    auto position = command.find(output.str());
+    if (position == std::string::npos)
+    {
+        return std::nullopt;
+    }
+    return command.replace(position, output.str().size(), "-o $out");
+}
+
+size_t project::schedule_shared_object_job(scheduler& jobs, const file& f, size_t compile_job, std::filesystem::path object)
+{
+    scheduler::job job;
+    job.name = f.get_file_path().string();
+    job.kind = job_kind::compile;
+    job.pool = job_pool::tool;
+    job.dependencies.push_back(compile_job);
+    job.estimated_duration = 0.01;
+    auto unchanged = std::make_shared<bool>(false);
+    job.action = [this, &f, object, unchanged](std::stringstream& output, Process::Stats&)
+        {
+            auto target = get_object_path(f);
+            auto before = _restat.take_snapshot(target);
+            try
+            {
+                fs::create_directories(target.parent_path());
+                file_copy::copy(object, target, false);
+            }
+            catch (fs::filesystem_error& error)
+            {
+                output << error.what() << std::endl;
+                return Process::Result::Failed;
+            }
+            *unchanged = _restat.compare(target, before);
+            return Process::Result::Success;
+        };
+    job.on_finish = [this, &f, object, unchanged](scheduler::job& job)
+        {
+            if (job.result == Process::Result::Failed)
+            {
+                _status = BuildStatus::Failed;
+                return;
+            }
+            // not recorded in the stats, the copy says nothing about compile times
+            _output << term::cyan << "Rebuilding " << f.get_file_path() << ": " << term::reset
+                    << term::green << (*unchanged ? "Unchanged" : "Shared with " + get_pretty_path(object).string()) << term::reset << std::endl;
+            _last_write = std::max(_last_write, _restat.get_write_time(get_object_path(f)));
+        };
+    return jobs.add(std::move(job));
+}
+
+bool project::has_relative_cflags()
+{
+    static const std::vector<std::string> path_flags = { "-I", "-isystem", "-iquote", "-idirafter", "-include", "-imacros", "-B" };
+    std::vector<std::string> flags = _config.cflags;
+    for (auto& lib : _config.libraries)
+    {
+        flags.insert(flags.end(), lib.config.cflags.begin(), lib.config.cflags.end());
+    }
+    bool path_expected = false;
+    for (auto& flag : flags)
+    {
+        // a flag line may hold several arguments
+        std::stringstream arguments(flag);
+        std::string argument;
+        while (arguments >> argument)
+        {
+            std::string value;
+            if (path_expected)
+            {
+                value = argument;
+            }
+            else
+            {
+                auto prefix = std::find_if(path_flags.begin(), path_flags.end(),
+                    [&](const std::string& path_flag) { return argument.starts_with(path_flag); });
+                if (prefix != path_flags.end())
+                {
+                    value = argument.substr(prefix->size());
+                }
+                else if (argument.find('/') != std::string::npos)
+                {
+                    // -fprofile-use=dir/data, --sysroot=dir, ...
+                    value = argument.substr(argument.find('=') + 1);
+                }
+            }
+            path_expected = !path_expected && value.empty() && std::find(path_flags.begin(), path_flags.end(), argument) != path_flags.end();
+            if (!value.empty() && fs::path(value).is_relative())
+            {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+std::vector<std::vector<const file*>> project::get_compile_batches(const std::vector<const file*>& sources)
+{
+    std::vector<std::vector<const file*>> batches;
+    // include folders are made absolute, a relative path in the flags isn't
+    bool relative_flags = has_relative_cflags();
+    // sources only share an invocation when their command is the same, which
+    // depends on the compiler (c or c++) and on the precompiled header
+    std::map<std::pair<bool, bool>, std::vector<const file*>> groups;
+    for (auto source : sources)
+    {
+        // the objects of a batch are moved, split dwarf and profile data would
+        // be named after the scratch directory
+        if (_config.compile_batch > 1 && estimate_compile_time(*source) * 2 <= _config.compile_batch_time
+            && !_module_units.contains(source->get_file_path().string()) && !(_options.debug && _config.split_dwarf)
+            && !_options.profile.starts_with("pgo") && !relative_flags)
+        {
+            groups[{ source->get_file_path().extension() == ".c", uses_pch(*source) }].push_back(source);
+        }
+        else
+        {
+            batches.push_back({ source });
+        }
+    }
+
+    for (auto& [key, group] : groups)
+    {
+        // don't batch so much that compile slots are left idle
+        auto jobs = get_job_limit();
+        size_t max_count = std::min(_config.compile_batch, (group.size() + jobs - 1) / jobs);
+        std::vector<const file*> batch;
+        std::set<std::string> names;
+        double time = 0.0;
+        for (auto source : group)
+        {
+            auto estimate = estimate_compile_time(*source);
+            // objects are written as <stem>.o in the working directory of the compiler
+            auto name = source->get_file_path().stem().string();
+            if (!batch.empty() && (batch.size() >= max_count || time + estimate > _config.compile_batch_time || names.contains(name)))
+            {
+                batches.push_back(batch);
+                batch.clear();
+                names.clear();
+                time = 0.0;
+            }
+            batch.push_back(source);
+            names.insert(name);
+            time += estimate;
+        }
+        if (!batch.empty())
+        {
+            batches.push_back(batch);
+        }
+    }
+    return batches;
+}
+
+size_t project::schedule_batch_job(scheduler& jobs, std::vector<const file*> sources, std::optional<size_t> pch_job)
+{
+    scheduler::job job;
+    job.name = sources.front()->get_file_path().string() + " (+" + std::to_string(sources.size() - 1) + " sources)";
+    job.kind = job_kind::compile;
+    job.pool = job_pool::compile;
+    if (pch_job.has_value() && uses_pch(*sources.front()))
+    {
+        job.dependencies.push_back(pch_job.value());
+    }
+    auto estimates = std::make_shared<std::vector<double>>();
+    job.estimated_duration = 0.0;
+    for (auto source : sources)
+    {
+        estimates->push_back(estimate_compile_time(*source));
+        job.estimated_duration += estimates->back();
+        job.estimated_memory = std::max(job.estimated_memory, estimate_compile_memory(*source));
+    }
+    auto directory = _obj_root / "batch" / std::to_string(_batch_count++);
+    // batches are grouped by pch use, the header is copied as a failed pch job
+    // clears it on the scheduling thread
+    std::optional<fs::path> pch;
+    if (uses_pch(*sources.front()))
+    {
+        pch = _pch_header;
+    }
+    auto failed = std::make_shared<std::vector<bool>>(sources.size(), false);
+    auto unchanged = std::make_shared<std::vector<bool>>(sources.size(), false);
+    job.action = [this, sources, directory, pch, failed, unchanged](std::stringstream& output, Process::Stats& stats)
+        {
+            std::vector<restat_log::snapshot> before;
+            for (auto source : sources)
+            {
+                before.push_back(_restat.take_snapshot(get_object_path(*source)));
+            }
+            auto result = compile_batch(sources, directory, pch, *failed, output, stats);
+            for (size_t i = 0; i < sources.size(); i++)
+            {
+                unchanged->at(i) = !failed->at(i) && _restat.compare(get_object_path(*sources[i]), before[i]);
+            }
+            return result;
+        };
+    job.on_finish = [this, sources, estimates, failed, unchanged](scheduler::job& job)
+        {
+            double total = 0.0;
+            for (auto estimate : *estimates)
+            {
+                total += estimate;
+            }
+            for (size_t i = 0; i < sources.size(); i++)
+            {
+                auto& f = *sources[i];
+                // the history is kept per source, split the invocation by estimate
+                auto stats = job.stats;
+                double share = total > 0.0 ? estimates->at(i) / total : 1.0 / sources.size();
+                stats.wall_time *= share;
+                stats.cpu_time *= share;
+                // a skipped batch never ran, its empty stats would skew the estimates
+                if (!job.skipped)
+                {
+                    _stats.record(job.kind, f.get_file_path().string(), job.start, stats);
+                }
+                _output << term::cyan << "Rebuilding " << f.get_file_path() << ": " << term::reset << std::flush;
+                if (job.skipped || failed->at(i))
+                {
+                    _status = BuildStatus::Failed;
+                    _output << term::red << "Failed " << term::reset << std::endl;
+                }
+                else
+                {
+                    _output << term::green << (unchanged->at(i) ? "Unchanged" : "Rebuilt") << term::reset << std::endl;
+                }
+                _last_write = std::max(_last_write, _restat.get_write_time(get_object_path(f)));
+            }
+        };
+    return jobs.add(std::move(job));
+}
+
+size_t project::schedule_link_job(scheduler& jobs, std::vector<size_t> dependencies)
+{
+    auto binary_path = compute_path(_options.root_directory, _config.get_binary_path());
+
+    scheduler::job job;
+    job.name = get_pretty_path(binary_path).string();
+    job.kind = job_kind::link;
+    job.pool = job_pool::link;
+    job.dependencies = dependencies;
+    // the cores left to each link while the link pool is full
+    _link_threads = std::max<size_t>(1, jobs.get_pool_limit(job_pool::compile) / jobs.get_pool_limit(job_pool::link));
+    job.estimated_memory = default_link_memory;
+    if (auto record = _stats.find_last(job_kind::link, job.name); record.has_value())
+    {
+        job.estimated_duration = record->wall_time;
+        job.estimated_memory = record->peak_rss;
+    }
+    job.action = [this, binary_path](std::stringstream& output, Process::Stats& stats)
+        {
+            if (is_library() && !is_shared())
+            {
+                return link_library(output, stats);
+            }
+            _linked = _options.force_linking || binary_requires_rebuild(_last_write);
+            if (!_linked)
+            {
+                if (is_shared() && !fs::exists(_obj_root / "fingerprint"))
+                {
+                    update_fingerprint();
+                }
+                return Process::Result::Success;
+            }
+            _output << "Creating " << (is_shared() ? "shared library" : "executable") << "..." << std::endl;
+            if (_config.version_script == "auto" && generate_version_script(output) == Process::Result::Failed)
+            {
+                return Process::Result::Failed;
+            }
+            auto cmd = get_link_command(binary_path.string());
+            if(_options.output_command) _output << cmd << std::endl;
+            auto result = Process::Run(cmd.c_str(), output, stats);
+            if (result == Process::Result::Success)
+            {
+                save_link_libraries();
+                if (is_shared())
+                {
+                    update_fingerprint();
+                }
+            }
+            return result;
+        };
+    job.on_finish = [this](scheduler::job& job)
+        {
+            if (job.skipped)
+            {
+                return;
+            }
+            if (!_linked)
+            {
+                _output << "Binary is up to date." << std::endl;
+                return;
+            }
+            _stats.record(job.kind, job.name, job.start, job.stats);
+            if (!is_library() || is_shared())
+            {
+                _stats.set_linker(get_linker());
+            }
+            if (job.result == Process::Result::Failed)
+            {
+                std::cerr << term::red << "Error creating binary" << term::reset << std::endl;
+                _output << job.output.str() << std::flush;
+            }
+            else
+            {
+                // the binary is shared by the profiles, this tells whose objects it holds
+                std::ofstream(_obj_root / "link.stamp");
+            }
+        };
+    return jobs.add(std::move(job));
+}
+
+bool project::uses_partial_link()
+{
+    // merged LTO objects would be optimized per directory instead of as a whole
+    return _config.partial_link && (!is_library() || is_shared()) && _options.profile != "lto";
+}
+
+std::map<fs::path, std::vector<fs::path>> project::get_partial_objects()
+{
+    std::map<fs::path, std::vector<fs::path>> directories;
+    for (auto unit : get_translation_units())
+    {
+        auto object = get_object_path(*unit);
+        auto directory = fs::relative(object.parent_path(), _obj_root);
+        directories[(_obj_root / "partial" / directory / "objects.o").lexically_normal()].push_back(object);
+    }
+    // a single object is linked as is
+    std::erase_if(directories, [](auto& directory) { return directory.second.size() < 2; });
+    return directories;
+}
+
+size_t project::schedule_partial_link_job(scheduler& jobs, fs::path partial, std::vector<fs::path> members, std::vector<size_t> dependencies)
+{
+    scheduler::job job;
+    job.name = get_pretty_path(partial).string();
+    job.kind = job_kind::partial_link;
+    job.pool = job_pool::codegen;
+    job.dependencies = dependencies;
+    if (auto record = _stats.find_last(job_kind::partial_link, job.name); record.has_value())
+    {
+        job.estimated_duration = record->wall_time;
+        job.estimated_memory = record->peak_rss;
+    }
+    else
+    {
+        job.estimated_duration = 0.01 * members.size();
+        job.estimated_memory = default_link_memory;
+    }
+    job.action = [this, partial, members](std::stringstream& output, Process::Stats& stats)
+        {
+            return partial_link(partial, members, output, stats);
+        };
+    job.on_finish = [this, partial](scheduler::job& job)
+        {
+            // no command ran when the partial object was up to date
+            if (job.skipped || job.stats.wall_time == 0.0)
+            {
+                return;
+            }
+            _stats.record(job.kind, job.name, job.start, job.stats);
+            if (job.result == Process::Result::Failed)
+            {
+                _status = BuildStatus::Failed;
+                std::cerr << term::red << "Error merging " << job.name << term::reset << std::endl;
+                _output << job.output.str() << std::flush;
+            }
+            else if (fs::exists(partial) && fs::last_write_time(partial) > _last_write)
+            {
+                _last_write = fs::last_write_time(partial);
+            }
+        };
+    return jobs.add(std::move(job));
+}
+
+Process::Result project::partial_link(const fs::path& partial, const std::vector<fs::path>& members,
+    std::stringstream& output, Process::Stats& stats)
+{
+    // manifest: the objects merged in the partial object
+    auto manifest_path = fs::path(partial).replace_extension(".members");
+    std::vector<std::string> merged;
+    std::ifstream manifest(manifest_path);
+    for (std::string line; std::getline(manifest, line);)
+    {
+        merged.push_back(line);
+    }
+    manifest.close();
+
+    bool stale = _options.force_linking || !fs::exists(partial) || merged.size() != members.size();
+    for (size_t i = 0; !stale && i < members.size(); i++)
+    {
+        stale = merged[i] != members[i].string() || _restat.get_write_time(members[i]) > fs::last_write_time(partial);
+    }
+    if (!stale)
+    {
+        return Process::Result::Success;
+    }
+
+    fs::create_directories(partial.parent_path());
+    std::stringstream command;
+    command << _config.compiler << " -r -nostdlib";
+    if (auto flags = linker::get_flags(get_linker(), 0); !flags.empty())
+    {
+        command << " " << flags;
+    }
+    command << " -o " << fs::relative(partial).string();
+    for (auto& member : members)
+    {
+        command << " " << fs::relative(member).string();
+    }
+    if (_options.output_command) _output << command.str() << std::endl;
+    auto result = Process::Run(command.str().c_str(), output, stats);
+    if (result == Process::Result::Success)
+    {
+        std::ofstream manifest(manifest_path);
+        for (auto& member : members)
+        {
+            manifest << member.string() << std::endl;
+        }
+    }
+    else
+    {
+        fs::remove(manifest_path);
+    }
+    return result;
+}
+
+std::vector<fs::path> project::get_link_inputs(bool partial)
+{
+    std::vector<fs::path> inputs;
+    std::unordered_map<std::string, fs::path> merged_into;
+    if (partial && uses_partial_link())
+    {
+        for (auto& [partial_object, members] : get_partial_objects())
+        {
+            for (auto& member : members)
+            {
+                merged_into[member.string()] = partial_object;
+            }
+        }
+    }
+    std::unordered_set<std::string> added;
+    for (auto unit : get_translation_units())
+    {
+        auto object = get_object_path(*unit);
+        auto merged = merged_into.find(object.string());
+        auto input = merged == merged_into.end() ? object : merged->second;
+        if (added.insert(input.string()).second)
+        {
+            inputs.push_back(input);
+        }
+    }
+    return inputs;
+}
+
+size_t project::get_job_limit()
+{
+    if (_options.jobs.has_value() && _options.jobs.value() > 0)
+    {
+        return _options.jobs.value();
+    }
+    if (_config.jobs > 0)
+    {
+        return _config.jobs;
+    }
+    return host::get_cpu_count();
+}
+
+double project::estimate_compile_time(const file& file)
+{
+    auto path = file.get_file_path().string();
+    if (auto record = _stats.find_last(job_kind::compile, path); record.has_value())
+    {
+        return record->wall_time;
+    }
+
+    // no history for this file, scale its include closure size by the
+    // throughput measured on the files we do know about
+    if (!_seconds_per_byte.has_value())
+    {
+        double known_time = 0.0;
+        double known_size = 0.0;
+        for (auto& other : get_files())
+        {
+            if (other.get_type() != FILE_TYPE::SOURCE)
+            {
+                continue;
+            }
+            // only the sources already scanned, a targeted build doesn't read the others
+            auto record = _stats.find_last(job_kind::compile, other.get_file_path().string());
+            if (record.has_value() && get_include_tree().contains(other.get_file_path()))
+            {
+                known_time += record->wall_time;
+                known_size += get_include_tree().get_closure_size(other.get_file_path());
+            }
+        }
+        _seconds_per_byte = known_size > 0.0 ? known_time / known_size : 1e-5;
+    }
+    get_include_tree().add(file.get_file_path(), _dep_context.include_folders);
+    return get_include_tree().get_closure_size(file.get_file_path()) * _seconds_per_byte.value();
+}
+
+Process::Result project::compile_object(const file& file, std::stringstream& output, Process::Stats& stats)
+{
+    auto object_path = get_object_path(file);
+    auto dir_path = object_path.remove_filename();
+    fs::path directory;
+    for(auto &dir : dir_path){
+        directory /= dir;
+        if (!fs::exists(directory))
+        {
+            std::error_code code;
+            fs::create_directory(directory, code);
+        }
+    }
+
+    std::string cmd = get_object_compilation_command(file);
+
+    if (_options.output_command) _output << std::endl << cmd << std::endl;
+    return Process::Run(cmd.c_str(), output, stats);
+}
+
+Process::Result project::compile_batch(const std::vector<const file*>& sources, const std::filesystem::path& directory,
+    const std::optional<std::filesystem::path>& pch, std::vector<bool>& failed, std::stringstream& output, Process::Stats& stats)
+{
+    // the compiler can't name several outputs, it is run from a scratch
+    // directory and the objects are moved in place afterward
+    fs::create_directories(directory);
+    for (auto source : sources)
+    {
+        fs::remove(directory / fs::path(source->get_file_path().stem()).replace_extension(".o"));
+    }
+
+    std::string compiler = _config.compiler;
+    if (compiler.compare("g++") == 0 && sources.front()->get_file_path().extension().string().compare(".c") == 0)
+    {
+        compiler = "gcc";
+    }
+    std::stringstream io;
+    io << "-c";
+    for (auto source : sources)
+    {
+        io << " " << fs::absolute(source->get_file_path()).lexically_normal();
+    }
+    if (pch.has_value())
+    {
+        io << " -include " << fs::absolute(pch.value());
+    }
+    auto cmd = get_compile_command(compiler, io.str(), true);
+    if (_options.output_command) _output << std::endl << cmd << std::endl;
+
+    std::stringstream batch_output;
+    auto result = Process::Run(cmd.c_str(), batch_output, stats, directory.string().c_str());
+    bool any_failed = false;
+    for (size_t i = 0; i < sources.size(); i++)
+    {
+        auto object = directory / fs::path(sources[i]->get_file_path().stem()).replace_extension(".o");
+        failed[i] = !fs::exists(object);
+        if (!failed[i])
+        {
+            auto target = get_object_path(*sources[i]);
+            fs::create_directories(target.parent_path());
+            fs::rename(object, target);
+        }
+        any_failed |= failed[i];
+    }
+    if (stats.signal != 0)
+    {
+        // killed, let the scheduler retry the whole invocation
+        output << batch_output.str();
+        return Process::Result::Failed;
+    }
+    if (result == Process::Result::Success && !any_failed)
+    {
+        output << batch_output.str();
+        return result;
+    }
+
+    // compile the sources without an object alone, so the diagnostics are
+    // attributed to the source they belong to
+    result = Process::Result::Success;
+    for (size_t i = 0; i < sources.size(); i++)
+    {
+        if (!failed[i])
+        {
+            continue;
+        }
+        std::stringstream source_output;
+        Process::Stats source_stats;
+        failed[i] = compile_object(*sources[i], source_output, source_stats) == Process::Result::Failed;
+        if (failed[i])
         {
-            auto output = t.output.str();
-            if (output.size() > 0)
-            {
-                _output << term::yellow << t.target_file->get_file_path() << " has warning:" << term::reset << std::endl;
-                _output << output << std::endl;
-            }
+            output << term::red << sources[i]->get_file_path().string() << ":" << term::reset << std::endl;
+            output << source_output.str();
+            result = Process::Result::Failed;
         }
     }
-
-    return status;
+    return result;
 }
 
-Process::Result project::compile_object(const file& file, std::stringstream& output)
+size_t project::estimate_compile_memory(const file& file)
 {
-    auto object_path = get_object_path(file);
-    auto dir_path = object_path.remove_filename();
-    fs::path directory;
-    for(auto &dir : dir_path){
-        directory /= dir;
-        if (!fs::exists(directory))
+    if (auto record = _stats.find_last(job_kind::compile, file.get_file_path().string()); record.has_value())
+    {
+        return record->peak_rss;
+    }
+    if (!_average_memory.has_value())
+    {
+        size_t total = 0;
+        size_t count = 0;
+        for (auto& other : get_files())
         {
-            std::error_code code;
-            fs::create_directory(directory, code);
+            if (other.get_type() != FILE_TYPE::SOURCE)
+            {
+                continue;
+            }
+            if (auto record = _stats.find_last(job_kind::compile, other.get_file_path().string()); record.has_value())
+            {
+                total += record->peak_rss;
+                count++;
+            }
         }
+        _average_memory = count > 0 ? total / count : default_compile_memory;
     }
-
-    std::string cmd = get_object_compilation_command(file);
-
-    if (_options.output_command) _output << std::endl << cmd << std::endl;
-    return Process::Run(cmd.c_str(), output);
+    return _average_memory.value();
 }
 
 std::string project::get_object_compilation_command(const file& file)
 {
-    std::stringstream command;
     std::string compiler = _config.compiler;
     if (compiler.compare("g++") == 0 && file.get_file_path().extension().string().compare(".c") == 0)
     {
         compiler = "gcc";
     }
+    std::stringstream io;
+    io << "-o " << std::filesystem::relative(get_object_path(file)) << get_module_flags(file) << " -c " << std::filesystem::relative(file.get_file_path());
+    if (uses_pch(file) && compiler.compare("gcc") != 0)
+    {
+        io << " -include " << std::filesystem::relative(_pch_header.value());
+    }
+    return get_compile_command(compiler, io.str());
+}
+
+std::string project::get_compile_command(const std::string& compiler, const std::string& io, bool absolute_paths)
+{
+    std::stringstream command;
     command << compiler << " ";
-    if(_options.debug) command << "-g ";
+    if(_options.debug)
+    {
+        command << "-g ";
+        // gcc writes the .dwo next to the -o object
+        if (_config.split_dwarf) command << "-gsplit-dwarf ";
+        if (_config.compress_debug) command << "-gz ";
+    }
+    if (auto flags = get_profile_flags(false); !flags.empty())
+    {
+        command << flags << " ";
+    }
     command << "-Wfatal-errors ";
     command << "-Wall ";
     command << "-fdiagnostics-color=always ";
@@ -406,12 +2300,20 @@ std::string project::get_object_compilation_command(const file& file)
     {
         command << "-std=" << _config.standard << " ";
     }
-    command << "-o " << std::filesystem::relative(get_object_path(file)) << " -c " << std::filesystem::relative(file.get_file_path());
+    command << io;
+    if (is_shared())
+    {
+        command << " -fPIC";
+    }
+    if (_config.hidden_visibility)
+    {
+        command << " -fvisibility=hidden -fvisibility-inlines-hidden";
+    }
 
     // includes
     for (auto& include : _config.include_folder)
     {
-        command << " -I" << include;
+        command << " -I" << (absolute_paths ? fs::absolute(include).string() : include);
     }
 #ifdef _WIN32
     command << " -I" << INCLUDE_EXPORT_PATH;
@@ -439,35 +2341,120 @@ std::string project::get_object_compilation_command(const file& file)
     return command.str();
 }
 
+std::string project::get_profile_flags(bool link)
+{
+    auto& profile = _options.profile;
+    // the instrumented binary writes its counters relative to where it runs
+    auto data = fs::absolute(get_profile_data()).lexically_normal().string();
+    std::stringstream flags;
+    if (profile == "debug")
+    {
+        flags << (link ? "" : "-O0");
+    }
+    else if (profile == "release")
+    {
+        flags << (link ? "" : "-O2 -DNDEBUG");
+    }
+    else if (profile == "lto")
+    {
+        // the link optimizes too, with one LTRANS partition job per link thread
+        flags << "-O2 ";
+        if (link)
+        {
+            flags << (is_clang() ? "-flto=thin -Wl,--thinlto-jobs=" : "-flto-partition=balanced -flto=") << std::max<size_t>(_link_threads, 1);
+        }
+        else
+        {
+            flags << "-DNDEBUG " << (is_clang() ? "-flto=thin" : "-flto");
+        }
+    }
+    else if (profile == "pgo-generate")
+    {
+        flags << (link ? "" : "-O2 -DNDEBUG ") << "-fprofile-generate=" << data;
+        if (!link && !is_clang())
+        {
+            flags << " -fprofile-update=atomic";
+        }
+    }
+    else if (profile == "pgo-use" && !link)
+    {
+        if (is_clang())
+        {
+            flags << "-O2 -DNDEBUG -fprofile-use=" << data << "/default.profdata -Wno-profile-instr-unprofiled";
+        }
+        else
+        {
+            flags << "-O2 -DNDEBUG -fprofile-use=" << data << " -fprofile-partial-training -Wno-missing-profile";
+        }
+    }
+    return flags.str();
+}
+
+std::string project::get_archiver()
+{
+    if (_options.profile != "lto")
+    {
+        return "ar";
+    }
+    return is_clang() ? "llvm-ar" : "gcc-ar";
+}
+
+Process::Result project::merge_profiles()
+{
+    if (!is_clang())
+    {
+        // gcc accumulates the counters of every run in the .gcda files
+        return Process::Result::Success;
+    }
+    std::stringstream command;
+    command << "llvm-profdata merge -output=" << fs::relative(get_profile_data() / "default.profdata").string();
+    for (auto& entry : fs::directory_iterator(get_profile_data()))
+    {
+        if (entry.path().extension() == ".profraw")
+        {
+            command << " " << fs::relative(entry.path()).string();
+        }
+    }
+    return Process::Run(command.str(), _output);
+}
+
 bool project::binary_requires_rebuild(fs::file_time_type last_write)
 {
     fs::path binary_path = compute_path(_options.root_directory, _config.get_binary_path());
-    if (fs::exists(binary_path))
+    auto link_stamp = _obj_root / "link.stamp";
+    if (fs::exists(binary_path) && fs::exists(link_stamp) && fs::last_write_time(link_stamp) >= fs::last_write_time(binary_path))
     {
         if (fs::last_write_time(binary_path) < last_write)
         {
             return true;
         }
 
-        fs::file_time_type library_last_write = fs::file_time_type::min();
-        for (auto path : _config.library_paths)
+        // fingerprints the libraries had at the last link: <fingerprint> <library>
+        std::unordered_map<std::string, std::string> linked;
+        std::ifstream linked_file(_obj_root / "libraries");
+        for (std::string fingerprint, library; linked_file >> fingerprint && std::getline(linked_file >> std::ws, library);)
         {
-            auto lib_path = compute_path(_options.root_directory, path);
-            for (auto lib : _config.libraries)
+            linked[library] = fingerprint;
+        }
+
+        auto libraries = get_external_libraries();
+        auto dependency_libraries = get_dependency_libraries();
+        libraries.insert(libraries.end(), dependency_libraries.begin(), dependency_libraries.end());
+        for (auto& library : libraries)
+        {
+            if (!fs::exists(library) || fs::last_write_time(library) <= fs::last_write_time(binary_path))
             {
-                fs::path full_path = fs::path(lib_path) / ("lib" + lib.name + LIB_EXT);
-                if (fs::exists(full_path))
-                {
-                    auto file_last_write = fs::last_write_time(full_path);
-                    if (file_last_write > library_last_write)
-                    {
-                        library_last_write = file_last_write;
-                    }
-                }
+                continue;
+            }
+            // a rebuilt library only matters when what the binary uses of it changed
+            auto it = linked.find(library.string());
+            if (it == linked.end() || get_library_fingerprint(library) != it->second)
+            {
+                return true;
             }
         }
-
-        if (fs::last_write_time(binary_path) < library_last_write)
+        if (auto version_script = get_version_script(); version_script.has_value() && _config.version_script != "auto"
+            && fs::last_write_time(version_script.value()) > fs::last_write_time(binary_path))
         {
             return true;
         }
@@ -476,6 +2463,133 @@ bool project::binary_requires_rebuild(fs::file_time_type last_write)
     return true;
 }
 
+// Exported dynamic symbols and soname of a shared library, the content of
+// anything else. The size of exported data is part of it, binaries using the
+// data have it copied at load time.
+std::optional<std::string> fingerprint_library(const fs::path& library)
+{
+    std::stringstream symbols;
+    if (library.extension() == SHARED_EXT && Process::Run("readelf -dW --dyn-syms " + fs::relative(library).string(), symbols) == Process::Result::Success)
+    {
+        // Num: Value Size Type Bind Vis Ndx Name
+        std::vector<std::string> interface;
+        std::string line;
+        while (std::getline(symbols, line))
+        {
+            if (auto soname = line.find("(SONAME)"); soname != std::string::npos)
+            {
+                interface.push_back(line.substr(soname));
+                continue;
+            }
+            std::stringstream fields(line);
+            std::string num, value, size, type, bind, visibility, index, name;
+            fields >> num >> value >> size >> type >> bind >> visibility >> index >> name;
+            if (name.empty() || num.back() != ':' || index == "UND" || (bind != "GLOBAL" && bind != "WEAK")
+                || visibility == "HIDDEN" || visibility == "INTERNAL")
+            {
+                continue;
+            }
+            interface.push_back(type + " " + bind + " " + name + (type == "OBJECT" || type == "TLS" ? " " + size : ""));
+        }
+        std::sort(interface.begin(), interface.end());
+        uint64_t fingerprint = 0;
+        for (auto& entry : interface)
+        {
+            fingerprint = hash::bytes(entry.data(), entry.size() + 1, fingerprint);
+        }
+        return hash::to_hex(fingerprint);
+    }
+    if (auto content = hash::file(library); content.has_value())
+    {
+        return hash::to_hex(content.value());
+    }
+    return std::nullopt;
+}
+
+std::optional<std::string> project::get_library_fingerprint(const fs::path& library)
+{
+    std::vector<project*> pending;
+    for (auto& dependency : _dependencies)
+    {
+        pending.push_back(dependency.get());
+    }
+    while (!pending.empty())
+    {
+        auto dependency = pending.back();
+        pending.pop_back();
+        if (compute_path(dependency->_options.root_directory, dependency->_config.get_binary_path()) == library)
+        {
+            std::string fingerprint;
+            if (std::ifstream(dependency->_obj_root / "fingerprint") >> fingerprint)
+            {
+                return fingerprint;
+            }
+            break;
+        }
+        for (auto& sub_dependency : dependency->_dependencies)
+        {
+            pending.push_back(sub_dependency.get());
+        }
+    }
+    if (!fs::exists(library))
+    {
+        return std::nullopt;
+    }
+    return fingerprint_library(library);
+}
+
+void project::update_fingerprint()
+{
+    std::optional<std::string> fingerprint;
+    if (is_shared())
+    {
+        fingerprint = fingerprint_library(compute_path(_options.root_directory, _config.get_binary_path()));
+    }
+    else
+    {
+        // the archive may be thin, the members tell what it holds
+        uint64_t members = 0;
+        for (auto unit : get_translation_units())
+        {
+            auto object = get_object_path(*unit);
+            auto name = fs::relative(object, _obj_root).generic_string();
+            members = hash::bytes(name.data(), name.size() + 1, members);
+            if (auto content = hash::file(object); content.has_value())
+            {
+                members = hash::bytes(&content.value(), sizeof(uint64_t), members);
+            }
+        }
+        fingerprint = hash::to_hex(members);
+    }
+
+    auto path = _obj_root / "fingerprint";
+    std::string previous;
+    std::ifstream(path) >> previous;
+    if (!fingerprint.has_value())
+    {
+        fs::remove(path);
+    }
+    else if (fingerprint.value() != previous)
+    {
+        std::ofstream(path) << fingerprint.value() << std::endl;
+    }
+}
+
+void project::save_link_libraries()
+{
+    std::ofstream file(_obj_root / "libraries");
+    auto libraries = get_external_libraries();
+    auto dependency_libraries = get_dependency_libraries();
+    libraries.insert(libraries.end(), dependency_libraries.begin(), dependency_libraries.end());
+    for (auto& library : libraries)
+    {
+        if (auto fingerprint = get_library_fingerprint(library); fingerprint.has_value())
+        {
+            file << fingerprint.value() << " " << library.string() << std::endl;
+        }
+    }
+}
+
 Process::Result project::link(std::stringstream& output)
 {
     std::stringstream command;
@@ -488,10 +2602,8 @@ Process::Result project::link(std::stringstream& output)
 
     auto binary_path = compute_path(_options.root_directory, _config.get_binary_path());
     command << "-o " << binary_path;
-    for(auto& f: _files){
-        if(f.get_type() == FILE_TYPE::SOURCE){
-            command << " " << get_object_path(f);
-        }
+    for(auto unit : get_translation_units()){
+        command << " " << get_object_path(*unit);
     }
 
     for (auto& libpath : _config.library_paths)
@@ -531,45 +2643,115 @@ Process::Result project::link(std::stringstream& output)
     return Process::Run(command.str().c_str(), output);
 }
 
-Process::Result project::link_library(std::stringstream& output)
+Process::Result project::link_library(std::stringstream& output, Process::Stats& stats)
 {
-    std::stringstream command;
     auto lib_file = compute_path(_options.root_directory, _config.get_binary_path());
-    if (fs::exists(lib_file))
+    auto manifest_path = _obj_root / "archive";
+    // members are named relative to the project so the manifest doesn't depend
+    // on the directory lzbuild runs from
+    std::vector<std::string> members;
+    for (auto unit : get_translation_units())
     {
-        fs::remove(lib_file);
+        members.push_back(fs::relative(get_object_path(*unit), _options.root_directory).string());
     }
-    
-    command << "ar rcs ";
-    
-    command << "-o " << lib_file;
-    
-    for (auto& f : _files)
+
+    // manifest: archive format then the members of the archive
+    std::ifstream manifest(manifest_path);
+    std::string format;
+    std::getline(manifest, format);
+    std::unordered_set<std::string> archived;
+    for (std::string line; std::getline(manifest, line);)
+    {
+        archived.insert(line);
+    }
+    manifest.close();
+
+    auto link_stamp = _obj_root / "link.stamp";
+    bool recreate = _options.force_linking || !fs::exists(lib_file) || format != (_config.thin_archive ? "thin" : "full")
+        || !fs::exists(link_stamp) || fs::last_write_time(link_stamp) < fs::last_write_time(lib_file);
+    std::unordered_set<std::string> current(members.begin(), members.end());
+    for (auto& member : archived)
+    {
+        recreate = recreate || !current.contains(member);
+    }
+    // a full archive matches members by file name, replacing one of two
+    // objects sharing a name would overwrite the other
+    std::unordered_set<std::string> names;
+    for (auto& member : members)
+    {
+        recreate = recreate || (!_config.thin_archive && !names.insert(fs::path(member).filename().string()).second);
+    }
+
+    std::vector<std::string> changed;
+    if (recreate)
+    {
+        if (fs::exists(lib_file))
+        {
+            fs::remove(lib_file);
+        }
+        changed = members;
+    }
+    else
+    {
+        auto archive_write = fs::last_write_time(lib_file);
+        for (auto& member : members)
+        {
+            if (!archived.contains(member) || _restat.get_write_time(_options.root_directory / member) > archive_write)
+            {
+                changed.push_back(member);
+            }
+        }
+    }
+    _linked = !changed.empty();
+    if (!_linked)
     {
-        if(f.get_type() == FILE_TYPE::SOURCE){
-            command << " " << get_object_path(f);
+        if (!fs::exists(_obj_root / "fingerprint"))
+        {
+            update_fingerprint();
         }
+        return Process::Result::Success;
     }
+    _output << "Creating library..." << std::endl;
 
+    std::stringstream command;
+    command << get_archiver() << " rcs" << (_config.thin_archive ? "T " : " ") << fs::relative(lib_file).string();
+    for (auto& member : changed)
+    {
+        command << " " << fs::relative(_options.root_directory / member).string();
+    }
     if (_options.output_command) _output << command.str() << std::endl;
-    return Process::Run(command.str().c_str(), output);
+    auto result = Process::Run(command.str().c_str(), output, stats);
+    if (result == Process::Result::Success)
+    {
+        std::ofstream manifest(manifest_path);
+        manifest << (_config.thin_archive ? "thin" : "full") << std::endl;
+        for (auto& member : members)
+        {
+            manifest << member << std::endl;
+        }
+        manifest.close();
+        update_fingerprint();
+    }
+    else
+    {
+        fs::remove(manifest_path);
+    }
+    return result;
 }
 
-std::string project::get_link_command(std::string output)
+std::string project::get_link_command(std::string output, bool detect_linker)
 {
     std::stringstream command;
 
-    if(is_library())
+    if(is_library() && !is_shared())
     {
-        command << "ar rcs ";
+        command << get_archiver() << (_config.thin_archive ? " rcsT " : " rcs ");
     
         command << "-o " << fs::relative(output);
         
-        for (auto& f : _files)
+        for (auto unit : get_translation_units())
         {
-            if(f.get_type() == FILE_TYPE::SOURCE){
-                command << " " << fs::relative(get_object_path(f));
-            }
+            command << " " << fs::relative(get_object_path(*unit));
         }
     }
     else
@@ -580,12 +2762,47 @@ std::string project::get_link_command(std::string output)
         command << "-Wall -Wextra ";
         command << "-fdiagnostics-color=always ";
         command << "-std=" << _config.standard << " ";
+        auto linker_name = detect_linker ? get_linker() : (_config.linker == "auto" || _config.linker == "default" ? "" : _config.linker);
+        if (auto flags = linker::get_flags(linker_name, _link_threads); !flags.empty())
+        {
+            command << flags << " ";
+        }
+        if (_options.debug && _config.compress_debug)
+        {
+            command << "-gz ";
+        }
+        if (auto flags = get_profile_flags(true); !flags.empty())
+        {
+            command << flags << " ";
+        }
+        // bfd can't build the index that spares gdb from reading every .dwo
+        if (_options.debug && _config.split_dwarf && !linker_name.empty() && linker_name != "bfd")
+        {
+            command << "-Wl,--gdb-index ";
+        }
 
         auto binary_path = compute_path(_options.root_directory, _config.get_binary_path());
         command << "-o " << fs::relative(binary_path);
-        for(auto& f: _files){
-            if(f.get_type() == FILE_TYPE::SOURCE){
-                command << " " << fs::relative(get_object_path(f));
+        if (is_shared())
+        {
+            command << " -shared -Wl,-soname," << binary_path.filename().string();
+            if (auto version_script = get_version_script(); version_script.has_value())
+            {
+                command << " -Wl,--version-script=" << fs::relative(version_script.value()).string();
+            }
+        }
+        // generated scripts link the objects, the partial objects only exist after lzbuild built them
+        for (auto& input : get_link_inputs(detect_linker))
+        {
+            command << " " << fs::relative(input);
+        }
+
+        for (auto& library : get_dependency_libraries())
+        {
+            command << " " << fs::relative(library);
+            if (library.extension() == SHARED_EXT)
+            {
+                command << " -Wl,-rpath," << fs::absolute(library).parent_path().string();
             }
         }
 
@@ -615,6 +2832,105 @@ std::string project::get_link_command(std::string output)
     return command.str();
 }
 
+std::string project::get_linker()
+{
+    if (!_linker.has_value())
+    {
+        if (_config.linker == "auto")
+        {
+            _linker = linker::detect(_config.compiler);
+        }
+        else
+        {
+            _linker = _config.linker == "default" ? "" : _config.linker;
+        }
+    }
+    return _linker.value();
+}
+
+std::optional<std::filesystem::path> project::get_version_script()
+{
+    if (!_config.version_script.has_value())
+    {
+        return std::nullopt;
+    }
+    if (_config.version_script.value() == "auto")
+    {
+        return _obj_root / (_config.name + ".map");
+    }
+    return fs::path(_config.version_script.value());
+}
+
+Process::Result project::generate_version_script(std::stringstream& output)
+{
+    std::stringstream command;
+    command << "readelf -sW";
+    for (auto unit : get_translation_units())
+    {
+        command << " " << fs::relative(get_object_path(*unit)).string();
+    }
+    std::stringstream symbols;
+    if (Process::Run(command.str(), symbols) == Process::Result::Failed)
+    {
+        output << symbols.str();
+        return Process::Result::Failed;
+    }
+
+    // Num: Value Size Type Bind Vis Ndx Name
+    std::set<std::string> exported;
+    std::string line;
+    while (std::getline(symbols, line))
+    {
+        std::stringstream fields(line);
+        std::string num, value, size, type, bind, visibility, index, name;
+        fields >> num >> value >> size >> type >> bind >> visibility >> index >> name;
+        if (name.empty() || num.back() != ':' || index == "UND" || visibility != "DEFAULT"
+            || (bind != "GLOBAL" && bind != "WEAK") || (type != "FUNC" && type != "OBJECT" && type != "TLS"))
+        {
+            continue;
+        }
+        exported.insert(name);
+    }
+
+    std::stringstream script;
+    script << get_version_node() << " {" << std::endl;
+    if (!exported.empty())
+    {
+        script << "  global:" << std::endl;
+        for (auto& name : exported)
+        {
+            script << "    " << name << ";" << std::endl;
+        }
+    }
+    script << "  local: *;" << std::endl << "};" << std::endl;
+
+    // keep the timestamp when nothing changed
+    auto path = get_version_script().value();
+    std::stringstream previous;
+    previous << std::ifstream(path).rdbuf();
+    if (previous.str() != script.str())
+    {
+        std::ofstream(path) << script.str();
+    }
+    return Process::Result::Success;
+}
+
+std::string project::get_version_node()
+{
+    auto node = _config.name;
+    std::transform(node.begin(), node.end(), node.begin(), [](char c) { return std::isalnum((unsigned char)c) ? (char)std::toupper(c) : '_'; });
+    return node;
+}
+
+std::vector<std::filesystem::path> project::run_export(file_exporter& exporter)
+{
+    // copies wait on the disk rather than the cpu, run as many as compiles
+    scheduler jobs(_output, get_job_limit());
+    jobs.set_pool_limit(job_pool::tool, get_job_limit());
+    configure_scheduler(jobs);
+    return exporter.run(jobs, _output);
+}
+
 std::filesystem::path project::get_pretty_path(std::filesystem::path path)
 {
     auto mismatch_pair = std::mismatch(path.begin(), path.end(), _options.root_directory.begin(), _options.root_directory.end());
@@ -623,16 +2939,40 @@ std::filesystem::path project::get_pretty_path(std::filesystem::path path)
 
 std::filesystem::path project::get_object_path(const file& file)
 {
+    auto path = fs::absolute(file.get_file_path()).lexically_normal();
+    auto obj_root = fs::absolute(_obj_root).lexically_normal();
+    if (std::mismatch(obj_root.begin(), obj_root.end(), path.begin(), path.end()).first == obj_root.end())
+    {
+        // generated sources already live in the object directory
+        return _obj_root / fs::relative(path, obj_root).replace_extension(".o");
+    }
     return _obj_root / fs::relative(file.get_file_path(), _options.root_directory).replace_extension(".o");
 }
 
+double project::get_build_time()
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - _build_start).count();
+}
+
 void project::export_asset_folder(std::filesystem::path path)
 {
     if(_config.asset_folder.has_value())
     {
         auto asset_folder = fs::canonical(_config.asset_folder.value());
-        fs::copy(asset_folder, path, fs::copy_options::overwrite_existing | fs::copy_options::recursive);
-        _output << term::green << "Exported " << asset_folder << " to " << path << term::green << std::endl;
+        file_exporter exporter(_obj_root / "export", _config.export_hardlinks);
+        if (_config.pack_assets)
+        {
+            auto pack = _obj_root / "assets.pack";
+            auto packed = asset_packer(pack, _config.compress_assets).update(asset_folder);
+            auto target = path;
+            exporter.add(pack, target += ".pack");
+            run_export(exporter);
+            _output << term::green << "Packed " << asset_folder << " in " << target << " (" << packed << " assets changed)" << term::reset << std::endl;
+            return;
+        }
+        exporter.add_directory(asset_folder, path);
+        auto exported = run_export(exporter);
+        _output << term::green << "Exported " << asset_folder << " to " << path << " (" << exported.size() << " files changed)" << term::reset << std::endl;
     }
 }
 
@@ -652,6 +2992,10 @@ void project::generate_compile_commands(std::filesystem::path folder)
 
     output << "[\n";
 
+    // editors only need the flags, the sources aren't scanned for includes and
+    // the precompiled header, chosen from the include graph, is left out
+    get_files();
+    scan_modules();
     std::vector<size_t> object_files;
     for (size_t i = 0; i < _files.size(); i++)
     {
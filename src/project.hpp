@@ -4,10 +4,20 @@
 #include <sstream>
 #include <iostream>
 #include <unordered_map>
+#include <unordered_set>
+#include <map>
+#include <memory>
+#include <chrono>
 #include "utility/args.hpp"
 #include "file.hpp"
 #include "config.hpp"
 #include "dependency_tree.hpp"
+#include "build_stats.hpp"
+#include "scheduler.hpp"
+#include "unity_build.hpp"
+#include "module_scanner.hpp"
+#include "restat_log.hpp"
+#include "file_exporter.hpp"
 #include "utility/cmd.hpp"
 
 struct build_options
@@ -19,12 +29,38 @@ struct build_options
     bool output_command = false;
     bool show_warning = false;
     bool print_dependencies = false;
+    bool dependencies_only = false;
     std::string config = "default.lzb";
     std::filesystem::path root_directory = std::filesystem::current_path();
     std::optional<std::filesystem::path> export_directory;
+    std::optional<size_t> jobs;
+    std::optional<double> max_load;
+    std::string profile; // debug, release, lto, pgo-generate or pgo-use, empty for none
+    std::vector<std::filesystem::path> targets; // absolute sources or directories to build, empty for all
+    bool no_link = false;
+    bool syntax_only = false;
+    bool check_first = false; // syntax checks of the dirty sources ahead of the build
 
     build_options(){}
     build_options(const ArgReader& args);
+    // Reads the sources and directories named on the command line of build or check
+    void read_targets(const ArgReader& args);
+    // Arguments of the command line that are neither flags nor flag values,
+    // the command name included
+    static std::vector<std::string> get_positional(const ArgReader& args);
+
+    // Each profile has its own object tree, except pgo-generate and pgo-use
+    // which share theirs so the profile data matches the objects
+    std::filesystem::path get_obj_root() const
+    {
+        auto tree = std::filesystem::path(config).stem().string();
+        if (!profile.empty())
+        {
+            tree += "-" + (profile.starts_with("pgo") ? std::string("pgo") : profile);
+        }
+        return root_directory / "obj" / tree;
+    }
+    std::filesystem::path get_stats_path() const { return get_obj_root() / "build_stats"; }
 };
 
 enum class BuildStatus
@@ -34,6 +70,21 @@ enum class BuildStatus
     Changed
 };
 
+class project;
+// Projects already loaded, by canonical config path, so a sub-project shared
+// by several dependents is built once. Null while the project is loading.
+using project_registry = std::unordered_map<std::string, std::shared_ptr<project>>;
+
+// Work shared by the projects built together, so configurations of the same
+// sources list and scan them once and compile identical objects once
+struct scan_cache
+{
+    std::unordered_map<std::string, std::vector<file>> listings; // by root, source folders and exclusions
+    std::unordered_map<std::string, std::shared_ptr<dependency_tree>> trees; // by include folders
+    // compile job and object of each command, with the object path left out
+    std::unordered_map<std::string, std::pair<size_t, std::filesystem::path>> objects;
+};
+
 class project
 {
 private:
@@ -41,34 +92,173 @@ private:
     config _config;
     std::vector<file> _files;
     bool _header_only = true;
+    // loading stages, each run on first use
+    bool _files_listed = false;
+    bool _dependencies_scanned = false;
+    bool _modules_scanned = false;
+    bool _sources_prepared = false;
     std::ostream& _output = std::cout;
-    dependency_tree _dep_tree;
+    std::shared_ptr<dependency_tree> _dep_tree;
     std::filesystem::path _obj_root;
+    build_stats _stats;
+    restat_log _restat;
+    std::shared_ptr<scan_cache> _scans;
+    std::chrono::steady_clock::time_point _build_start;
+    std::optional<double> _seconds_per_byte;
+    std::optional<size_t> _average_memory;
+    BuildStatus _status = BuildStatus::NoChange;
+    fs::file_time_type _last_write = fs::file_time_type::min();
+    std::vector<size_t> _compile_jobs;
+    std::optional<size_t> _link_job;
+    bool _linked = false;
+    std::vector<std::shared_ptr<project>> _dependencies;
+    bool _scheduled = false;
+    bool _finished = false;
+    bool _build_started = false;
+    std::vector<size_t> _ready_jobs;
+    dependency_context _dep_context;
+    std::optional<std::filesystem::path> _pch_header;
+    size_t _pch_users = 0;
+    size_t _pch_header_count = 0;
+    std::optional<unity_build> _unity;
+    std::vector<file> _unity_files;
+    size_t _batch_count = 0;
+    std::optional<std::string> _linker;
+    size_t _link_threads = 0;
+    std::unordered_map<std::string, module_unit> _module_units; // by source path
+    std::unordered_map<std::string, const file*> _module_providers; // by module name
 
 public:
     project(const ArgReader& args);
     project(const build_options& options, std::ostream& output = std::cout);
+    project(const build_options& options, std::ostream& output, project_registry& registry, std::shared_ptr<scan_cache> scans);
 
     Process::Result build();
+    // Builds several configurations with one scheduler, sharing their scans and identical objects
+    static Process::Result build_all(const std::vector<build_options>& configs, std::ostream& output = std::cout);
+    // Combines the profiles written by a pgo-generate binary for pgo-use
+    Process::Result merge_profiles();
+    std::optional<std::string> get_training_command() { return _config.pgo_train; }
+    std::filesystem::path get_profile_data() { return _obj_root / "profile"; }
     void export_binary(std::filesystem::path target);
     void export_asset_folder(std::filesystem::path target);
     std::string get_name() { return _config.name; }
     bool is_library() { return _config.is_library; }
-    bool is_header_only() { return _header_only; }
+    bool is_shared() { return _config.is_library && _config.link_type == library_link_type::shared; }
+    bool is_header_only();
     void export_header_files(std::filesystem::path target);
-    void build_file_registry();
     std::string get_build_commands();
+    // build.ninja building this project and its sub-projects in parallel and incrementally
+    std::string get_ninja_file();
     void generate_compile_commands(std::filesystem::path folder);
     void generate_pkg_config(std::filesystem::path folder);
 
 private:
-    BuildStatus compile_project_async(fs::file_time_type& last_write);
-    Process::Result compile_object(const file& file, std::stringstream& output);
+    void load(project_registry& registry);
+    void load_dependencies(project_registry& registry);
+    // Sources and headers of the source folders, listed and classified by extension
+    std::vector<file>& get_files();
+    void build_file_registry();
+    // Include graph shared with the projects of the same include folders, sources are added as they are checked
+    dependency_tree& get_include_tree();
+    // Include graph of every source
+    dependency_tree& get_dependency_tree();
+    // Whether a source or a file it includes is newer than time, only reads the includes of that source
+    bool is_stale(const std::filesystem::path& source, fs::file_time_type time);
+    // Whether a translation unit is one of the targets or in one of their directories
+    bool is_targeted(const file& unit);
+    // Module scan, unity sources and precompiled header, needed to compile
+    void prepare_sources();
+    void write_ninja_statements(std::ostream& output, std::unordered_set<const project*>& written, std::vector<std::string>& defaults);
+    std::vector<std::filesystem::path> get_dependency_libraries();
+    // Libraries of _config.libraries found in the library paths
+    std::vector<std::filesystem::path> get_external_libraries();
+    // Hash of what a binary linking a library depends on, the one stored by the
+    // sub-project producing it when there is one
+    std::optional<std::string> get_library_fingerprint(const std::filesystem::path& library);
+    // Stores the fingerprint of the library this project produces, kept as is when unchanged
+    void update_fingerprint();
+    // Stores the fingerprints of the libraries a binary was linked with
+    void save_link_libraries();
+    void begin_build(std::chrono::steady_clock::time_point start);
+    void configure_scheduler(scheduler& jobs);
+    // Adds the jobs of this project and its dependencies, returns the jobs
+    // dependents have to wait for before linking
+    std::vector<size_t> schedule(scheduler& jobs, bool is_root = true);
+    Process::Result finish_build(scheduler& jobs);
+    void setup_pch();
+    bool uses_pch(const file& file);
+    std::filesystem::path get_pch_output();
+    std::string get_pch_command();
+    std::optional<size_t> schedule_pch_job(scheduler& jobs);
+    void scan_modules();
+    std::filesystem::path get_bmi_path(const std::string& module);
+    std::string get_module_flags(const file& file);
+    // Orders module interfaces before the units importing them
+    std::vector<const file*> sort_by_imports(const std::vector<const file*>& units);
+    void setup_unity();
+    void write_unity_sources();
+    void count_unity_edits();
+    // Sources compiled on their own followed by the generated unity sources
+    std::vector<const file*> get_translation_units();
+    std::vector<size_t> schedule_compile_jobs(scheduler& jobs, std::optional<size_t> pch_job);
+    size_t schedule_compile_job(scheduler& jobs, const file& f, std::optional<size_t> pch_job);
+    // Compile command of a source without its object path, the same across
+    // configurations that can share the object
+    std::optional<std::string> get_shared_command(const file& f);
+    // Sources newer than the object they are compiled in, most recently modified first
+    std::vector<const file*> get_dirty_sources();
+    // Compiles a source with -fsyntax-only, no object is written. Checks run
+    // before the other jobs and print their diagnostics as soon as they finish.
+    size_t schedule_syntax_check_job(scheduler& jobs, const file& f, std::optional<size_t> pch_job);
+    // Copies the object another project compiles with the same command
+    size_t schedule_shared_object_job(scheduler& jobs, const file& f, size_t compile_job, std::filesystem::path object);
+    // Groups small sources sharing a compile command into one compiler invocation
+    std::vector<std::vector<const file*>> get_compile_batches(const std::vector<const file*>& sources);
+    // Flags naming a relative path, which a batch run from its scratch directory would miss
+    bool has_relative_cflags();
+    size_t schedule_batch_job(scheduler& jobs, std::vector<const file*> sources, std::optional<size_t> pch_job);
+    // pch is the header force-included in every source of the batch, if they use it
+    Process::Result compile_batch(const std::vector<const file*>& sources, const std::filesystem::path& directory,
+        const std::optional<std::filesystem::path>& pch, std::vector<bool>& failed, std::stringstream& output, Process::Stats& stats);
+    size_t schedule_link_job(scheduler& jobs, std::vector<size_t> dependencies);
+    bool uses_partial_link();
+    // Objects of each directory merged into one relocatable object, by the path of the merged object
+    std::map<std::filesystem::path, std::vector<std::filesystem::path>> get_partial_objects();
+    size_t schedule_partial_link_job(scheduler& jobs, std::filesystem::path partial,
+        std::vector<std::filesystem::path> members, std::vector<size_t> dependencies);
+    // Re-merges the objects with ld -r when one of them changed
+    Process::Result partial_link(const std::filesystem::path& partial, const std::vector<std::filesystem::path>& members,
+        std::stringstream& output, Process::Stats& stats);
+    // Objects given to the final link, merged per directory with partial linking
+    std::vector<std::filesystem::path> get_link_inputs(bool partial);
+    size_t get_job_limit();
+    double estimate_compile_time(const file& file);
+    size_t estimate_compile_memory(const file& file);
+    Process::Result compile_object(const file& file, std::stringstream& output, Process::Stats& stats);
     std::string get_object_compilation_command(const file& file);
+    std::string get_compile_command(const std::string& compiler, const std::string& io, bool absolute_paths = false);
+    std::string get_profile_flags(bool link);
+    // gcc-ar or llvm-ar when objects hold LTO bytecode
+    std::string get_archiver();
+    bool is_clang() { return _config.compiler.find("clang") != std::string::npos; }
     bool binary_requires_rebuild(fs::file_time_type last_write);
     Process::Result link(std::stringstream& output);
-    Process::Result link_library(std::stringstream& output);
-    std::string get_link_command(std::string output);
+    // Replaces the archive members whose object changed, the archive is only
+    // recreated when members were removed or the archive format changed
+    Process::Result link_library(std::stringstream& output, Process::Stats& stats);
+    // The linker is only probed for when detect_linker is set, generated
+    // scripts must not depend on the linkers of this machine
+    std::string get_link_command(std::string output, bool detect_linker = true);
+    std::optional<std::filesystem::path> get_version_script();
+    std::string get_linker();
+    // Lists the visible symbols defined by the objects in a version script
+    Process::Result generate_version_script(std::stringstream& output);
+    // Version node of the generated version script, the project name as an identifier
+    std::string get_version_node();
+    // Copies the files changed since the last export, returns the destinations written
+    std::vector<std::filesystem::path> run_export(file_exporter& exporter);
     std::filesystem::path get_pretty_path(std::filesystem::path path);
     std::filesystem::path get_object_path(const file& file);
+    double get_build_time();
 };
\ No newline at end of file
@@ -0,0 +1,110 @@
+#include "restat_log.hpp"
+#include <fstream>
+#include <sstream>
+#include "utility/hash.hpp"
+
+namespace fs = std::filesystem;
+
+namespace
+{
+    fs::file_time_type from_ticks(long long ticks)
+    {
+        return fs::file_time_type(fs::file_time_type::duration(ticks));
+    }
+}
+
+restat_log::restat_log(std::filesystem::path path) : _path(path)
+{
+}
+
+void restat_log::load()
+{
+    std::lock_guard lock(_mutex);
+    _entries.clear();
+    std::ifstream file(_path);
+    std::string line;
+    while (std::getline(file, line))
+    {
+        // <content time> <file time> <object>
+        std::stringstream ss(line);
+        long long content_time = 0, file_time = 0;
+        std::string object;
+        ss >> content_time >> file_time;
+        std::getline(ss >> std::ws, object);
+        if (ss.fail() || object.empty())
+        {
+            continue;
+        }
+        _entries[object] = { from_ticks(content_time), from_ticks(file_time) };
+    }
+}
+
+void restat_log::save()
+{
+    std::lock_guard lock(_mutex);
+    // entries of objects rewritten with new content since are dropped
+    std::erase_if(_entries, [](auto& item) {
+        std::error_code code;
+        return fs::last_write_time(item.first, code) != item.second.file_time || code;
+    });
+    if (_entries.empty())
+    {
+        fs::remove(_path);
+        return;
+    }
+    fs::create_directories(_path.parent_path());
+    std::ofstream file(_path);
+    for (auto& [object, e] : _entries)
+    {
+        file << e.content_time.time_since_epoch().count() << " " << e.file_time.time_since_epoch().count() << " " << object << "\n";
+    }
+}
+
+std::optional<fs::file_time_type> restat_log::find(const std::filesystem::path& object) const
+{
+    std::error_code code;
+    auto file_time = fs::last_write_time(object, code);
+    if (code)
+    {
+        return std::nullopt;
+    }
+    std::lock_guard lock(_mutex);
+    if (auto it = _entries.find(object.string()); it != _entries.end() && it->second.file_time == file_time)
+    {
+        return it->second.content_time;
+    }
+    return file_time;
+}
+
+restat_log::snapshot restat_log::take_snapshot(const std::filesystem::path& object) const
+{
+    snapshot before;
+    if (auto write_time = find(object); write_time.has_value())
+    {
+        before.write_time = write_time.value();
+        before.hash = hash::file(object);
+    }
+    return before;
+}
+
+bool restat_log::compare(const std::filesystem::path& object, const snapshot& before)
+{
+    if (!before.hash.has_value() || hash::file(object) != before.hash)
+    {
+        return false;
+    }
+    std::error_code code;
+    auto file_time = fs::last_write_time(object, code);
+    if (code)
+    {
+        return false;
+    }
+    std::lock_guard lock(_mutex);
+    _entries[object.string()] = { before.write_time, file_time };
+    return true;
+}
+
+std::filesystem::file_time_type restat_log::get_write_time(const std::filesystem::path& object) const
+{
+    return find(object).value_or(fs::file_time_type::min());
+}
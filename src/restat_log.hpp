@@ -0,0 +1,48 @@
+#pragma once
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+
+// Remembers the objects recompiled to the same bytes. Such an object keeps the
+// write time of its previous content, so the binaries and merged objects made
+// from it aren't considered stale. Shared by the compile jobs of a project.
+class restat_log
+{
+public:
+    // An object as it was before being recompiled
+    struct snapshot
+    {
+        std::optional<uint64_t> hash;
+        std::filesystem::file_time_type write_time;
+    };
+
+private:
+    struct entry
+    {
+        std::filesystem::file_time_type content_time; // when the content was first written
+        std::filesystem::file_time_type file_time;    // when the object was last rewritten
+    };
+
+    std::filesystem::path _path;
+    std::unordered_map<std::string, entry> _entries;
+    mutable std::mutex _mutex;
+
+public:
+    restat_log(std::filesystem::path path);
+
+    void load();
+    void save();
+
+    snapshot take_snapshot(const std::filesystem::path& object) const;
+    // Compares a recompiled object with its snapshot, returns true when the
+    // content is the same
+    bool compare(const std::filesystem::path& object, const snapshot& before);
+    // Write time of the content of an object
+    std::filesystem::file_time_type get_write_time(const std::filesystem::path& object) const;
+
+private:
+    std::optional<std::filesystem::file_time_type> find(const std::filesystem::path& object) const;
+};
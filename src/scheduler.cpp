@@ -0,0 +1,286 @@
+#include "scheduler.hpp"
+#include "utility/host.hpp"
+#include "utility/term.hpp"
+#include <algorithm>
+#include <csignal>
+#include <cmath>
+#include <condition_variable>
+#include <iomanip>
+#include <mutex>
+#include <queue>
+#include <thread>
+
+const size_t max_attempts = 3;
+
+scheduler::scheduler(std::ostream& output, size_t max_jobs, std::chrono::steady_clock::time_point start)
+    : _output(output), _max_jobs(std::max<size_t>(max_jobs, 1)), _start(start)
+{
+}
+
+size_t scheduler::add(job job)
+{
+    _jobs.push_back(std::move(job));
+    return _jobs.size() - 1;
+}
+
+void scheduler::compute_priorities()
+{
+    // priority is the job duration plus the longest chain of jobs waiting on it
+    std::vector<std::vector<size_t>> dependents(_jobs.size());
+    for (size_t i = 0; i < _jobs.size(); i++)
+    {
+        for (auto dependency : _jobs[i].dependencies)
+        {
+            dependents[dependency].push_back(i);
+        }
+    }
+    std::vector<bool> computed(_jobs.size(), false);
+    std::function<double(size_t)> compute = [&](size_t id) -> double
+    {
+        if (computed[id])
+        {
+            return _jobs[id].priority;
+        }
+        computed[id] = true;
+        double longest = 0.0;
+        for (auto dependent : dependents[id])
+        {
+            longest = std::max(longest, compute(dependent));
+        }
+        _jobs[id].priority = _jobs[id].estimated_duration + longest;
+        return _jobs[id].priority;
+    };
+    for (size_t i = 0; i < _jobs.size(); i++)
+    {
+        compute(i);
+    }
+}
+
+bool scheduler::run()
+{
+    compute_priorities();
+
+    std::vector<size_t> remaining(_jobs.size());
+    std::vector<std::vector<size_t>> dependents(_jobs.size());
+    for (size_t i = 0; i < _jobs.size(); i++)
+    {
+        remaining[i] = _jobs[i].dependencies.size();
+        for (auto dependency : _jobs[i].dependencies)
+        {
+            dependents[dependency].push_back(i);
+        }
+    }
+
+    auto compare = [&](size_t a, size_t b)
+    {
+        if (_jobs[a].urgent != _jobs[b].urgent)
+        {
+            return _jobs[b].urgent;
+        }
+        return _jobs[a].urgent ? a > b : _jobs[a].priority < _jobs[b].priority;
+    };
+    using queue = std::priority_queue<size_t, std::vector<size_t>, decltype(compare)>;
+    std::map<std::string, queue> ready;
+    std::map<std::string, size_t> pool_running;
+    auto push_ready = [&](size_t id)
+    {
+        auto& pool = _jobs[id].pool;
+        auto it = ready.find(pool);
+        if (it == ready.end())
+        {
+            it = ready.emplace(pool, queue(compare)).first;
+        }
+        it->second.push(id);
+    };
+    for (size_t i = 0; i < _jobs.size(); i++)
+    {
+        if (remaining[i] == 0)
+        {
+            push_ready(i);
+        }
+    }
+
+    auto now = [&]() { return std::chrono::duration<double>(std::chrono::steady_clock::now() - _start).count(); };
+    double run_start = now();
+
+    std::mutex mutex;
+    std::condition_variable finished_condition;
+    std::vector<size_t> finished;
+    std::vector<std::thread> threads(_jobs.size());
+    size_t running = 0;
+    size_t done = 0;
+    bool success = true;
+    size_t reserved_memory = 0;
+    std::optional<size_t> memory_budget;
+
+    std::function<void(size_t)> skip = [&](size_t id)
+    {
+        for (auto dependent : dependents[id])
+        {
+            auto& job = _jobs[dependent];
+            if (job.skipped)
+            {
+                continue;
+            }
+            job.skipped = true;
+            job.result = Process::Result::Failed;
+            done++;
+            if (job.on_finish) job.on_finish(job);
+            skip(dependent);
+        }
+    };
+
+    while (done < _jobs.size())
+    {
+        if (running == 0)
+        {
+            // only sample while idle so our own jobs are not counted twice
+            memory_budget = host::get_available_memory();
+        }
+        for (auto& [pool, pool_ready] : ready)
+        {
+            // the job limit bounds all the pools together, a pool only narrows it
+            size_t limit = get_job_limit(pool, running);
+            while (running < _max_jobs && pool_running[pool] < limit && !pool_ready.empty())
+            {
+                size_t id = pool_ready.top();
+                size_t memory = _jobs[id].estimated_memory;
+                if (running > 0 && memory_budget.has_value() && reserved_memory + memory > memory_budget.value() * 9 / 10)
+                {
+                    break;
+                }
+                pool_ready.pop();
+                reserved_memory += memory;
+                _jobs[id].start = now();
+                running++;
+                pool_running[pool]++;
+                threads[id] = std::thread([&, id]()
+                    {
+                        auto& job = _jobs[id];
+                        auto result = job.action(job.output, job.stats);
+                        std::lock_guard lock(mutex);
+                        job.result = result;
+                        finished.push_back(id);
+                        finished_condition.notify_one();
+                    });
+            }
+        }
+
+        if (running == 0)
+        {
+            // remaining jobs can never become ready
+            success = false;
+            break;
+        }
+
+        std::vector<size_t> batch;
+        {
+            std::unique_lock lock(mutex);
+            finished_condition.wait(lock, [&]() { return !finished.empty(); });
+            batch.swap(finished);
+        }
+
+        for (auto id : batch)
+        {
+            threads[id].join();
+            auto& job = _jobs[id];
+            running--;
+            pool_running[job.pool]--;
+            reserved_memory -= std::min(reserved_memory, job.estimated_memory);
+            _busy_time += job.stats.wall_time;
+#ifdef SIGKILL
+            if (job.stats.signal == SIGKILL && ++job.attempts < max_attempts)
+            {
+                size_t limit = std::max<size_t>(get_pool_limit(job.pool) / 2, 1);
+                _pool_limits[job.pool] = limit;
+                job.estimated_memory = std::max(job.estimated_memory, (size_t)job.stats.peak_rss);
+                job.output.str("");
+                job.output.clear();
+                job.stats = Process::Stats();
+                _output << term::yellow << job.name << " was killed, retrying with at most " << limit << " " << job.pool << " jobs" << term::reset << std::endl;
+                push_ready(id);
+                continue;
+            }
+#endif
+            done++;
+            if (job.on_finish) job.on_finish(job);
+            if (job.result == Process::Result::Failed)
+            {
+                success = false;
+                skip(id);
+                continue;
+            }
+            for (auto dependent : dependents[id])
+            {
+                if (--remaining[dependent] == 0 && !_jobs[dependent].skipped)
+                {
+                    push_ready(dependent);
+                }
+            }
+        }
+    }
+
+    _elapsed = now() - run_start;
+    return success;
+}
+
+size_t scheduler::get_pool_limit(const std::string& pool) const
+{
+    if (auto it = _pool_limits.find(pool); it != _pool_limits.end())
+    {
+        return it->second;
+    }
+    if (pool == job_pool::link)
+    {
+        return std::min<size_t>(_max_jobs, 2);
+    }
+    if (pool == job_pool::tool)
+    {
+        return 4;
+    }
+    return _max_jobs;
+}
+
+size_t scheduler::get_job_limit(const std::string& pool, size_t running) const
+{
+    size_t limit = get_pool_limit(pool);
+    if (!_max_load.has_value())
+    {
+        return limit;
+    }
+    auto load = host::get_load_average();
+    if (!load.has_value())
+    {
+        return limit;
+    }
+    // leave room for whatever else is loading the machine
+    double other_load = std::max(0.0, load.value() - running);
+    double available = std::floor(_max_load.value() - other_load);
+    return std::clamp<size_t>(available > 0.0 ? (size_t)available : 0, 1, limit);
+}
+
+double scheduler::get_efficiency() const
+{
+    size_t slots = std::min(get_pool_limit(job_pool::compile), _jobs.size());
+    if (slots == 0 || _elapsed <= 0.0)
+    {
+        return 1.0;
+    }
+    return std::min(1.0, _busy_time / (_elapsed * slots));
+}
+
+void scheduler::print_summary(std::ostream& output) const
+{
+    if (_jobs.empty() || _busy_time <= 0.0)
+    {
+        return;
+    }
+    size_t slots = std::min(get_pool_limit(job_pool::compile), _jobs.size());
+    auto flags = output.flags();
+    auto precision = output.precision();
+    output << std::fixed << std::setprecision(2)
+           << "Ran " << _jobs.size() << " jobs in " << _elapsed << "s (" << _busy_time << "s of work, "
+           << std::setprecision(0) << get_efficiency() * 100 << "% parallel efficiency on " << slots << " slots)" << std::endl;
+    output.flags(flags);
+    output.precision(precision);
+}
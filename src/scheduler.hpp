@@ -0,0 +1,92 @@
+#pragma once
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <map>
+#include <optional>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "build_stats.hpp"
+#include "utility/cmd.hpp"
+
+// Named resource pools, each with its own concurrency limit
+namespace job_pool
+{
+    constexpr const char* compile = "compile";
+    constexpr const char* link = "link";
+    constexpr const char* codegen = "codegen";
+    constexpr const char* tool = "tool";
+}
+
+// Runs a graph of jobs, starting the ready job with the longest remaining
+// critical path first within each pool. A job is only admitted while the
+// predicted memory of the running jobs fits in the memory available, and a
+// job killed by the OOM killer is retried with a lower limit for its pool.
+class scheduler
+{
+public:
+    struct job
+    {
+        std::string name;
+        job_kind kind = job_kind::compile;
+        std::string pool = job_pool::compile;
+        std::function<Process::Result(std::stringstream& output, Process::Stats& stats)> action;
+        // called on the scheduling thread once the job is done
+        std::function<void(job& job)> on_finish;
+        std::vector<size_t> dependencies;
+        double estimated_duration = 1.0;
+        size_t estimated_memory = 0; // kilobytes
+        // started before the other ready jobs of its pool, in the order added
+        bool urgent = false;
+
+        // filled by the scheduler
+        Process::Result result = Process::Result::Success;
+        bool skipped = false;
+        Process::Stats stats;
+        std::stringstream output;
+        double start = 0.0;
+        double priority = 0.0;
+        size_t attempts = 0;
+    };
+
+private:
+    std::deque<job> _jobs;
+    std::ostream& _output;
+    size_t _max_jobs;
+    std::map<std::string, size_t> _pool_limits;
+    std::optional<double> _max_load;
+    std::chrono::steady_clock::time_point _start;
+    double _busy_time = 0.0;
+    double _elapsed = 0.0;
+
+public:
+    scheduler(std::ostream& output, size_t max_jobs, std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now());
+
+    // Hold back new jobs while the system load average is above this target
+    void set_max_load(std::optional<double> max_load) { _max_load = max_load; }
+
+    // Compile and codegen pools default to the job limit, links to 2 and
+    // external tools to 4. The running jobs of all pools never exceed the
+    // job limit.
+    void set_pool_limit(const std::string& pool, size_t limit) { _pool_limits[pool] = std::max<size_t>(limit, 1); }
+    size_t get_pool_limit(const std::string& pool) const;
+
+    size_t add(job job);
+    job& get(size_t id) { return _jobs.at(id); }
+    size_t size() const { return _jobs.size(); }
+
+    // Returns false if any job failed
+    bool run();
+
+    std::chrono::steady_clock::time_point get_start() const { return _start; }
+    double get_elapsed() const { return _elapsed; }
+    double get_efficiency() const;
+    void print_summary(std::ostream& output) const;
+
+private:
+    void compute_priorities();
+    size_t get_job_limit(const std::string& pool, size_t running) const;
+};
@@ -0,0 +1,210 @@
+#include "unity_build.hpp"
+#include <fstream>
+#include <sstream>
+#include <system_error>
+
+namespace fs = std::filesystem;
+
+unity_build::unity_build(std::filesystem::path directory, unity_mode mode, size_t batch_size, size_t split_threshold)
+    : _directory(directory), _mode(mode), _batch_size(batch_size), _split_threshold(split_threshold)
+{
+}
+
+void unity_build::load()
+{
+    _entries.clear();
+    std::ifstream file(_directory / "batches");
+    std::string line;
+    while (std::getline(file, line))
+    {
+        // <batch or -> <edits> <source>
+        std::stringstream ss(line);
+        entry e;
+        std::string source;
+        ss >> e.batch >> e.edits;
+        std::getline(ss >> std::ws, source);
+        if (ss.fail() && source.empty())
+        {
+            continue;
+        }
+        if (e.batch == "-")
+        {
+            e.batch.clear();
+        }
+        _entries[source] = e;
+    }
+    count_members();
+}
+
+void unity_build::save()
+{
+    fs::create_directories(_directory);
+    std::ofstream file(_directory / "batches");
+    for (auto& [source, e] : _entries)
+    {
+        file << (e.batch.empty() ? "-" : e.batch) << " " << e.edits << " " << source << "\n";
+    }
+}
+
+std::string unity_build::get_group(const std::filesystem::path& source) const
+{
+    if (_mode != unity_mode::directory)
+    {
+        return "unity";
+    }
+    auto group = source.parent_path().generic_string();
+    for (auto& c : group)
+    {
+        if (!std::isalnum((unsigned char)c))
+        {
+            c = '_';
+        }
+    }
+    return group.empty() ? "root" : group;
+}
+
+void unity_build::update(const std::vector<std::filesystem::path>& sources)
+{
+    std::map<std::string, entry> entries;
+    std::map<std::string, size_t> batch_sizes;
+    auto file_size = [](const std::string& path)
+        {
+            std::error_code error;
+            auto size = fs::file_size(path, error);
+            return error ? 0 : (size_t)size;
+        };
+
+    // sources already known keep their batch
+    std::vector<std::string> added;
+    for (auto& source : sources)
+    {
+        auto key = source.generic_string();
+        if (auto it = _entries.find(key); it != _entries.end())
+        {
+            entries[key] = it->second;
+            if (!it->second.batch.empty())
+            {
+                batch_sizes[it->second.batch] += file_size(key);
+            }
+        }
+        else
+        {
+            added.push_back(key);
+        }
+    }
+
+    for (auto& source : added)
+    {
+        auto group = get_group(source);
+        auto size = file_size(source);
+        // the last batch of the group with room left, or a new one
+        std::string batch;
+        size_t index = 0;
+        for (auto& [name, batch_size] : batch_sizes)
+        {
+            if (name.rfind(group + "_", 0) != 0 || name.find('_', group.size() + 1) != std::string::npos)
+            {
+                continue;
+            }
+            index = std::max(index, std::stoul(name.substr(group.size() + 1)) + 1);
+            if (batch_size + size <= _batch_size)
+            {
+                batch = name;
+            }
+        }
+        if (batch.empty())
+        {
+            batch = group + "_" + std::to_string(index);
+        }
+        batch_sizes[batch] += size;
+        entries[source] = entry{ .batch = batch, .edits = 0 };
+    }
+    _entries = entries;
+    count_members();
+}
+
+bool unity_build::record_edit(const std::filesystem::path& source)
+{
+    auto it = _entries.find(source.generic_string());
+    if (it == _entries.end() || it->second.batch.empty())
+    {
+        return false;
+    }
+    if (++it->second.edits >= _split_threshold)
+    {
+        _members[it->second.batch]--;
+        it->second.batch.clear();
+        return true;
+    }
+    return false;
+}
+
+std::map<std::string, std::vector<std::string>> unity_build::get_batches() const
+{
+    std::map<std::string, std::vector<std::string>> batches;
+    for (auto& [source, e] : _entries)
+    {
+        if (!e.batch.empty())
+        {
+            batches[e.batch].push_back(source);
+        }
+    }
+    return batches;
+}
+
+void unity_build::count_members()
+{
+    _members.clear();
+    for (auto& [source, e] : _entries)
+    {
+        if (!e.batch.empty())
+        {
+            _members[e.batch]++;
+        }
+    }
+}
+
+bool unity_build::is_batched(const std::filesystem::path& source) const
+{
+    auto it = _entries.find(source.generic_string());
+    if (it == _entries.end() || it->second.batch.empty())
+    {
+        return false;
+    }
+    // a batch of one is not worth a generated source
+    return _members.at(it->second.batch) > 1;
+}
+
+std::filesystem::path unity_build::get_batch_source(const std::filesystem::path& source) const
+{
+    return _directory / (_entries.at(source.generic_string()).batch + ".cpp");
+}
+
+std::vector<std::filesystem::path> unity_build::write_sources() const
+{
+    std::vector<fs::path> paths;
+    fs::create_directories(_directory);
+    for (auto& [batch, sources] : get_batches())
+    {
+        if (sources.size() < 2)
+        {
+            continue;
+        }
+        auto path = _directory / (batch + ".cpp");
+        std::stringstream content;
+        content << "// Generated by lzbuild, unity batch " << batch << std::endl;
+        for (auto& source : sources)
+        {
+            content << "#include \"" << fs::relative(fs::absolute(source), fs::absolute(_directory)).generic_string() << "\"" << std::endl;
+        }
+        // keep the timestamp when nothing changed, the batch object depends on it
+        std::stringstream previous;
+        previous << std::ifstream(path).rdbuf();
+        if (previous.str() != content.str())
+        {
+            std::ofstream(path) << content.str();
+        }
+        paths.push_back(path);
+    }
+    return paths;
+}
@@ -0,0 +1,53 @@
+#pragma once
+#include <filesystem>
+#include <map>
+#include <string>
+#include <vector>
+
+enum class unity_mode
+{
+    off,
+    directory,
+    size
+};
+
+// Groups sources into generated unity translation units. Assignments are
+// stored in the object directory so a batch keeps its members across builds,
+// and sources edited repeatedly are moved out into their own translation unit.
+class unity_build
+{
+    struct entry
+    {
+        std::string batch; // empty when the source is compiled on its own
+        size_t edits = 0;
+    };
+
+    std::filesystem::path _directory;
+    unity_mode _mode;
+    size_t _batch_size;
+    size_t _split_threshold;
+    std::map<std::string, entry> _entries;
+    std::map<std::string, size_t> _members; // sources per batch
+
+public:
+    unity_build(std::filesystem::path directory, unity_mode mode, size_t batch_size, size_t split_threshold);
+
+    void load();
+    void save();
+
+    // Drops removed sources and assigns new ones to a batch with room left
+    void update(const std::vector<std::filesystem::path>& sources);
+    // Counts an edit of a batched source, returns true when it gets split out
+    bool record_edit(const std::filesystem::path& source);
+    bool is_batched(const std::filesystem::path& source) const;
+    // Generated source of the batch a source is compiled in
+    std::filesystem::path get_batch_source(const std::filesystem::path& source) const;
+
+    // Writes the unity sources whose content changed, returns every unity source
+    std::vector<std::filesystem::path> write_sources() const;
+
+private:
+    std::map<std::string, std::vector<std::string>> get_batches() const;
+    std::string get_group(const std::filesystem::path& source) const;
+    void count_members();
+};
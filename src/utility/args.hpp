@@ -4,6 +4,7 @@
 #include <string>
 #include <vector>
 #include <iostream>
+#include <algorithm>
 
 class ArgReader{
     private:
@@ -41,6 +42,30 @@ class ArgReader{
         return false;
     }
 
+    // Arguments that are neither flags nor the value of one of value_flags
+    std::vector<std::string> get_positional(const std::vector<std::string>& value_flags) const {
+        std::vector<std::string> values;
+        for(size_t i = 0; i < args.size(); i++){
+            if(args[i].starts_with("-")){
+                if(std::find(value_flags.begin(), value_flags.end(), args[i]) != value_flags.end()) i++;
+                continue;
+            }
+            values.push_back(args[i]);
+        }
+        return values;
+    }
+
+    // Values of a flag given several times, in order
+    std::vector<std::string> get_all(std::string flag) const {
+        std::vector<std::string> values;
+        for(size_t i = 0; i + 1 < args.size(); i++){
+            if(args[i] == flag){
+                values.push_back(args[i + 1]);
+            }
+        }
+        return values;
+    }
+
     bool is(size_t index, std::string value) { return index < args.size() && args[index] == value; }
 
     std::string get_binary_dir() { return binary_dir; }
@@ -1,9 +1,11 @@
 #include "cmd.hpp"
+#include <chrono>
 #ifdef __unix__
 #include "sys/types.h"
 #include "unistd.h"
 #include "stdio.h"
 #include <sys/wait.h>
+#include <sys/resource.h>
 #include <iostream>
 #include <string>
 #include <string.h>
@@ -45,6 +47,18 @@ Process::Result Process::Run(const char* cmd)
 
 Process::Result Process::Run(const char* cmd, std::ostream& output)
 {
+    Stats stats;
+    return Run(cmd, output, stats);
+}
+
+Process::Result Process::Run(const char* cmd, std::ostream& output, Stats& stats)
+{
+    return Run(cmd, output, stats, nullptr);
+}
+
+Process::Result Process::Run(const char* cmd, std::ostream& output, Stats& stats, const char* directory)
+{
+    auto start = std::chrono::steady_clock::now();
     #ifdef __unix__
         int out[2];
         pipe(out);
@@ -56,6 +70,11 @@ Process::Result Process::Run(const char* cmd, std::ostream& output)
             dup2(out[1], STDOUT_FILENO);
             dup2(out[1], STDERR_FILENO);
             close(out[1]);
+            if (directory != nullptr && chdir(directory) < 0)
+            {
+                std::cerr << "Error:" << strerror(errno) << std::endl;
+                exit(1);
+            }
             std::vector<char*> fargs;
             fargs.reserve(args.size() + 1);
             for (size_t i = 0; i < args.size() + 1; i++)
@@ -78,21 +97,25 @@ Process::Result Process::Run(const char* cmd, std::ostream& output)
         }
         close(out[1]);
         int status = 0;
-        char buf[33];
-        while (waitpid(pid, &status, WNOHANG) >= 0)
+        char buf[257];
+        while (true)
         {
-            while (true)
+            int n = read(out[0], buf, 256);
+            if (n <= 0)
             {
-                int n = read(out[0], buf, 32);
-                if (n <= 0)
-                {
-                    break;
-                }
-                buf[n] = '\0';
-                output << buf;
+                break;
             }
+            buf[n] = '\0';
+            output << buf;
         }
         close(out[0]);
+        struct rusage usage = {};
+        wait4(pid, &status, 0, &usage);
+        stats.wall_time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        stats.cpu_time = usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6
+            + usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6;
+        stats.peak_rss = usage.ru_maxrss;
+        stats.signal = WIFSIGNALED(status) ? WTERMSIG(status) : 0;
         return status == 0 ? Process::Result::Success : Process::Result::Failed;
     #elif _WIN32
         HANDLE hPipeRead, hPipeWrite;
@@ -114,7 +137,7 @@ Process::Result Process::Run(const char* cmd, std::ostream& output)
         si.hStdError = hPipeWrite;
         std::string cmdStr = cmd;
         // std::wstring cmdWStr(cmdStr.begin(), cmdStr.end());
-        if (!CreateProcess(NULL, const_cast<char*>(cmdStr.c_str()), NULL, NULL, TRUE, 0, NULL, NULL, &si, &pi))
+        if (!CreateProcess(NULL, const_cast<char*>(cmdStr.c_str()), NULL, NULL, TRUE, 0, NULL, directory, &si, &pi))
         {
             CloseHandle(hPipeRead);
             CloseHandle(hPipeWrite);
@@ -135,6 +158,13 @@ Process::Result Process::Run(const char* cmd, std::ostream& output)
         WaitForSingleObject(pi.hProcess, INFINITE);
         DWORD exitCode;
         GetExitCodeProcess(pi.hProcess, &exitCode);
+        stats.wall_time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        FILETIME creation_time, exit_time, kernel_time, user_time;
+        if (GetProcessTimes(pi.hProcess, &creation_time, &exit_time, &kernel_time, &user_time))
+        {
+            auto to_seconds = [](FILETIME t) { return (((ULONGLONG)t.dwHighDateTime << 32) | t.dwLowDateTime) / 1e7; };
+            stats.cpu_time = to_seconds(kernel_time) + to_seconds(user_time);
+        }
         CloseHandle(pi.hProcess);
         CloseHandle(pi.hThread);
         CloseHandle(hPipeRead);
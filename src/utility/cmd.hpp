@@ -11,10 +11,21 @@ class Process {
         Failed
     };
 
+    // Resource usage of a finished child process
+    struct Stats {
+        double wall_time = 0.0; // seconds
+        double cpu_time = 0.0;  // user + system seconds
+        long peak_rss = 0;      // kilobytes
+        int signal = 0;         // terminating signal, 0 if exited normally
+    };
+
     public:
     static Result Run(const char* cmd);
     static Result Run(const char* cmd, std::ostream& output);
+    static Result Run(const char* cmd, std::ostream& output, Stats& stats);
+    // Runs the command from another working directory
+    static Result Run(const char* cmd, std::ostream& output, Stats& stats, const char* directory);
     static Result Run(std::string cmd) { return Run(cmd.c_str()); }
     static Result Run(std::string cmd, std::ostream& output) { return Run(cmd.c_str(), output); }
+    static Result Run(std::string cmd, std::ostream& output, Stats& stats) { return Run(cmd.c_str(), output, stats); }
 };
-
@@ -0,0 +1,104 @@
+#include "file_copy.hpp"
+#include <system_error>
+#ifdef __linux__
+#include <fcntl.h>
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+namespace
+{
+#ifdef __linux__
+    // Tries a reflink then copy_file_range, returns false when neither is supported
+    bool copy_in_kernel(const fs::path& source, const fs::path& destination, file_copy::method& method)
+    {
+        int input = open(source.c_str(), O_RDONLY | O_CLOEXEC);
+        if (input < 0)
+        {
+            throw fs::filesystem_error("Could not open", source, std::error_code(errno, std::generic_category()));
+        }
+        struct stat status;
+        fstat(input, &status);
+        int output = open(destination.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, status.st_mode & 07777);
+        if (output < 0)
+        {
+            auto error = errno;
+            close(input);
+            throw fs::filesystem_error("Could not create", destination, std::error_code(error, std::generic_category()));
+        }
+
+        bool copied = false;
+        if (ioctl(output, FICLONE, input) == 0)
+        {
+            method = file_copy::method::reflink;
+            copied = true;
+        }
+        else
+        {
+            off_t remaining = status.st_size;
+            copied = true;
+            while (remaining > 0)
+            {
+                auto count = copy_file_range(input, nullptr, output, nullptr, remaining, 0);
+                if (count <= 0)
+                {
+                    // unsupported across these filesystems, or the source shrank
+                    copied = false;
+                    break;
+                }
+                remaining -= count;
+            }
+            method = file_copy::method::copy_range;
+        }
+        close(input);
+        close(output);
+        return copied;
+    }
+#endif
+}
+
+file_copy::method file_copy::copy(const fs::path& source, const fs::path& destination, bool hardlink)
+{
+    auto temporary = destination;
+    temporary += ".lzbuild-tmp";
+    std::error_code code;
+    fs::remove(temporary, code);
+
+    auto method = method::copy;
+    bool copied = false;
+    if (hardlink)
+    {
+        fs::create_hard_link(source, temporary, code);
+        copied = !code;
+        method = method::hardlink;
+    }
+#ifdef __linux__
+    if (!copied)
+    {
+        copied = copy_in_kernel(source, temporary, method);
+    }
+#endif
+    if (!copied)
+    {
+        fs::copy_file(source, temporary, fs::copy_options::overwrite_existing);
+        method = method::copy;
+    }
+    fs::rename(temporary, destination);
+    return method;
+}
+
+const char* file_copy::get_name(method method)
+{
+    switch (method)
+    {
+    case method::reflink: return "reflink";
+    case method::copy_range: return "copy_file_range";
+    case method::hardlink: return "hardlink";
+    case method::copy: return "copy";
+    }
+    return "copy";
+}
@@ -0,0 +1,21 @@
+#pragma once
+#include <filesystem>
+
+// Copies that share storage with the source when the filesystem allows it
+namespace file_copy
+{
+    enum class method
+    {
+        reflink,    // FICLONE, the copy shares the extents of the source
+        copy_range, // copy_file_range, copied in the kernel
+        hardlink,
+        copy
+    };
+
+    // Replaces destination with the content of source, through a temporary
+    // file renamed in place so readers never see a partial file. Hardlinks
+    // are only made when allowed, and only across the same filesystem.
+    // Throws a filesystem_error on failure.
+    method copy(const std::filesystem::path& source, const std::filesystem::path& destination, bool hardlink);
+    const char* get_name(method method);
+}
@@ -0,0 +1,67 @@
+#include "hash.hpp"
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+namespace
+{
+    constexpr uint64_t prime = 0x9E3779B97F4A7C15ull;
+
+    uint64_t mix(uint64_t hash)
+    {
+        hash ^= hash >> 33;
+        hash *= 0xFF51AFD7ED558CCDull;
+        hash ^= hash >> 33;
+        return hash;
+    }
+}
+
+uint64_t hash::bytes(const void* data, size_t size, uint64_t seed)
+{
+    // a word at a time, objects are hashed on every rebuild
+    auto input = static_cast<const unsigned char*>(data);
+    uint64_t hash = seed ^ (size * prime);
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8)
+    {
+        uint64_t word;
+        std::memcpy(&word, input + i, 8);
+        hash = (hash ^ mix(word * prime)) * prime;
+        hash = (hash << 31) | (hash >> 33);
+    }
+    uint64_t tail = 0;
+    std::memcpy(&tail, input + i, size - i);
+    hash = (hash ^ mix(tail * prime + (size - i))) * prime;
+    return mix(hash);
+}
+
+std::optional<uint64_t> hash::file(const std::filesystem::path& path)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file)
+    {
+        return std::nullopt;
+    }
+    std::vector<char> buffer(1 << 16);
+    uint64_t hash = 0;
+    while (file)
+    {
+        file.read(buffer.data(), buffer.size());
+        if (file.gcount() > 0)
+        {
+            hash = bytes(buffer.data(), file.gcount(), hash);
+        }
+    }
+    return file.eof() ? std::optional<uint64_t>(hash) : std::nullopt;
+}
+
+std::string hash::to_hex(uint64_t hash)
+{
+    static const char digits[] = "0123456789abcdef";
+    std::string hex(16, '0');
+    for (size_t i = 0; i < 16; i++)
+    {
+        hex[15 - i] = digits[(hash >> (i * 4)) & 0xF];
+    }
+    return hex;
+}
@@ -0,0 +1,16 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <string>
+
+// Content hashes to tell whether an output really changed, not for security
+namespace hash
+{
+    // 64 bit hash of a buffer, chained through seed
+    uint64_t bytes(const void* data, size_t size, uint64_t seed = 0);
+    // Hash of the content of a file, empty if it can't be read
+    std::optional<uint64_t> file(const std::filesystem::path& path);
+    std::string to_hex(uint64_t hash);
+}
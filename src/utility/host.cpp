@@ -0,0 +1,138 @@
+#include "host.hpp"
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+namespace fs = std::filesystem;
+
+std::optional<std::filesystem::path> host::get_cgroup_path()
+{
+#ifdef __linux__
+    std::ifstream file("/proc/self/cgroup");
+    std::string line;
+    while (std::getline(file, line))
+    {
+        // cgroup v2 entries have the form "0::/path"
+        if (line.rfind("0::", 0) == 0)
+        {
+            fs::path path = fs::path("/sys/fs/cgroup") / fs::path(line.substr(3)).relative_path();
+            if (fs::exists(path / "cgroup.controllers"))
+            {
+                return path;
+            }
+        }
+    }
+#endif
+    return std::nullopt;
+}
+
+std::optional<double> read_cpu_quota(fs::path cgroup)
+{
+    std::optional<double> quota;
+    // the effective quota is the smallest one along the hierarchy
+    for (auto path = cgroup; ; path = path.parent_path())
+    {
+        std::ifstream file(path / "cpu.max");
+        std::string max;
+        double period = 0;
+        if (file >> max >> period && max != "max" && period > 0)
+        {
+            double cpus = std::stod(max) / period;
+            quota = quota.has_value() ? std::min(quota.value(), cpus) : cpus;
+        }
+        if (path == "/sys/fs/cgroup" || path == path.parent_path())
+        {
+            break;
+        }
+    }
+    return quota;
+}
+
+size_t host::get_cpu_count()
+{
+    size_t count = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(set), &set) == 0)
+    {
+        count = std::max(CPU_COUNT(&set), 1);
+    }
+    if (auto cgroup = get_cgroup_path(); cgroup.has_value())
+    {
+        if (auto quota = read_cpu_quota(cgroup.value()); quota.has_value())
+        {
+            count = std::clamp<size_t>((size_t)std::ceil(quota.value()), 1, count);
+        }
+    }
+#endif
+    return count;
+}
+
+std::optional<size_t> read_memory_room(fs::path cgroup)
+{
+    std::optional<size_t> room;
+    for (auto path = cgroup; ; path = path.parent_path())
+    {
+        std::ifstream max_file(path / "memory.max");
+        std::ifstream current_file(path / "memory.current");
+        std::string max;
+        size_t current = 0;
+        if (max_file >> max && max != "max" && current_file >> current)
+        {
+            size_t limit = std::stoull(max);
+            size_t available = limit > current ? (limit - current) / 1024 : 0;
+            room = room.has_value() ? std::min(room.value(), available) : available;
+        }
+        if (path == "/sys/fs/cgroup" || path == path.parent_path())
+        {
+            break;
+        }
+    }
+    return room;
+}
+
+std::optional<size_t> host::get_available_memory()
+{
+#ifdef __linux__
+    std::optional<size_t> available;
+    std::ifstream meminfo("/proc/meminfo");
+    std::string line;
+    while (std::getline(meminfo, line))
+    {
+        if (line.rfind("MemAvailable:", 0) == 0)
+        {
+            available = std::stoull(line.substr(line.find(':') + 1));
+            break;
+        }
+    }
+    if (auto cgroup = get_cgroup_path(); cgroup.has_value())
+    {
+        if (auto room = read_memory_room(cgroup.value()); room.has_value())
+        {
+            available = available.has_value() ? std::min(available.value(), room.value()) : room.value();
+        }
+    }
+    return available;
+#else
+    return std::nullopt;
+#endif
+}
+
+std::optional<double> host::get_load_average()
+{
+#ifdef __unix__
+    double load = 0.0;
+    if (getloadavg(&load, 1) == 1)
+    {
+        return load;
+    }
+#endif
+    return std::nullopt;
+}
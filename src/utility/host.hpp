@@ -0,0 +1,18 @@
+#pragma once
+#include <cstddef>
+#include <filesystem>
+#include <optional>
+
+// Queries about the machine the build is running on
+namespace host
+{
+    // CPUs this process may use: the affinity mask, capped by the cgroup v2 cpu.max quota
+    size_t get_cpu_count();
+    // One minute load average, if the platform exposes it
+    std::optional<double> get_load_average();
+    // Memory in kilobytes that can be used without swapping: MemAvailable,
+    // capped by the room left under the cgroup v2 memory.max limits
+    std::optional<size_t> get_available_memory();
+    // Directory of the cgroup v2 this process belongs to
+    std::optional<std::filesystem::path> get_cgroup_path();
+}
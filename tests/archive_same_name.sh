@@ -0,0 +1,36 @@
+#!/bin/bash
+# Static library with two sources of the same name in different directories:
+# updating one of them must keep the symbols of both in the archive.
+# usage: tests/archive_same_name.sh [lzbuild binary]
+set -e
+LZBUILD=$(realpath "${1:-bin/lzbuild}")
+dir=$(mktemp -d)
+trap 'rm -rf "$dir"' EXIT
+cd "$dir"
+mkdir -p src/a src/b
+printf 'name samename\noutput library\n' > default.lzb
+echo 'int from_a() { return 1; }' > src/a/u.cpp
+echo 'int from_b() { return 2; }' > src/b/u.cpp
+"$LZBUILD" build > /dev/null
+
+# the archive order depends on the directory listing, update each side in turn
+check() {
+    local symbols
+    symbols=$(nm -C bin/libsamename.a)
+    for symbol in "$@"; do
+        if ! grep -qF "T $symbol" <<< "$symbols"; then
+            echo "FAIL: $symbol missing from the archive"
+            echo "$symbols"
+            exit 1
+        fi
+    done
+}
+sleep 1.1
+echo 'int from_a() { return 3; } int from_a_new() { return 4; }' > src/a/u.cpp
+"$LZBUILD" build > /dev/null
+check 'from_a()' 'from_a_new()' 'from_b()'
+sleep 1.1
+echo 'int from_b() { return 5; } int from_b_new() { return 6; }' > src/b/u.cpp
+"$LZBUILD" build > /dev/null
+check 'from_a()' 'from_a_new()' 'from_b()' 'from_b_new()'
+echo "PASS"
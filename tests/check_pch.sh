@@ -0,0 +1,42 @@
+#!/bin/bash
+# Header edited between two checks: the syntax check must see the new header,
+# not the precompiled one built before the edit.
+# usage: tests/check_pch.sh [lzbuild binary]
+set -e
+LZBUILD=$(realpath "${1:-bin/lzbuild}")
+dir=$(mktemp -d)
+trap 'rm -rf "$dir"' EXIT
+cd "$dir"
+mkdir -p src
+printf 'name checkpch\noutput binary\npch auto\n' > default.lzb
+printf '#pragma once\ninline int value() { return 1; }\n' > src/common.hpp
+echo '#include "common.hpp"
+int other() { return value(); }' > src/other.cpp
+echo '#include "common.hpp"
+int main() { return value(); }' > src/main.cpp
+"$LZBUILD" build > /dev/null
+if ! ls obj/default/pch/*.gch > /dev/null 2>&1; then
+    echo "FAIL: no precompiled header was built"
+    exit 1
+fi
+
+# a declaration only in the new header
+sleep 1.1
+printf '#pragma once\ninline int value() { return 1; }\ninline int added() { return 2; }\n' > src/common.hpp
+echo '#include "common.hpp"
+int main() { return value() + added(); }' > src/main.cpp
+if ! "$LZBUILD" check > output.txt 2>&1; then
+    echo "FAIL: check read the outdated precompiled header"
+    cat output.txt
+    exit 1
+fi
+
+# an error only in the new header
+sleep 1.1
+echo '#error edited header' >> src/common.hpp
+if "$LZBUILD" check > output.txt 2>&1; then
+    echo "FAIL: check missed the error in the edited header"
+    cat output.txt
+    exit 1
+fi
+echo "PASS"
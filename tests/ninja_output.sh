@@ -0,0 +1,32 @@
+#!/bin/bash
+# lzbuild ninja writes to the output file given after the command, with or
+# without a configuration flag before it.
+# usage: tests/ninja_output.sh [lzbuild binary]
+set -e
+LZBUILD=$(realpath "${1:-bin/lzbuild}")
+dir=$(mktemp -d)
+trap 'rm -rf "$dir"' EXIT
+cd "$dir"
+mkdir -p src
+printf 'name ninjaout\noutput binary\n' > x.lzb
+echo 'int main() { return 0; }' > src/main.cpp
+
+check() {
+    local output=$1
+    shift
+    rm -f build.ninja "$output"
+    "$LZBUILD" ninja "$@" > /dev/null
+    if [ ! -f "$output" ]; then
+        echo "FAIL: lzbuild ninja $* did not write $output"
+        ls
+        exit 1
+    fi
+    if [ "$output" != build.ninja ] && [ -f build.ninja ]; then
+        echo "FAIL: lzbuild ninja $* also wrote build.ninja"
+        exit 1
+    fi
+}
+check out.ninja -c x.lzb out.ninja
+check out.ninja out.ninja -c x.lzb
+check build.ninja -c x.lzb
+echo "PASS"